@@ -0,0 +1,67 @@
+/**
+ * @file AllocationCounter.h
+ * @brief Interface to the library that counts heap allocations
+ */
+
+#ifndef FRAMEWORK_ALLOCATIONCOUNTER_H_
+#define FRAMEWORK_ALLOCATIONCOUNTER_H_
+
+// STL
+#include <atomic>
+
+namespace framework {
+
+/**
+ * @struct AllocationCounter
+ * @brief Counts kept by the allocation counter library
+ *
+ * The library (libFramework_AllocationCounter.so) replaces the global
+ * operator new and delete, so it isn't linked into the framework or
+ * anything else. It is preloaded into jobs that track memory
+ *
+ *     LD_PRELOAD=libFramework_AllocationCounter.so fire config.py
+ *
+ * and the MemoryTracker finds it by looking up the functions below.
+ * When tracking is disabled, the replacements only check a flag and
+ * then call malloc/free like the default implementation.
+ */
+struct AllocationCounter {
+  /// Maximum number of tags counted, later processors are counted as other
+  static constexpr int MAX_TAGS{512};
+
+  /**
+   * Counts for one tag
+   *
+   * These are kept in static storage so that they exist before anything
+   * is allocated and counting them never allocates.
+   */
+  struct Counts {
+    /// Number of allocations
+    std::atomic<long> allocations;
+    /// Number of bytes allocated
+    std::atomic<long> bytes;
+    /// Number of deallocations
+    std::atomic<long> frees;
+    /// Growth of the peak resident set size [kB]
+    std::atomic<long> peakGrowth;
+  };
+
+  /// True if allocations are being counted
+  std::atomic<bool> tracking;
+
+  /// Counts of each tag
+  Counts counts[MAX_TAGS];
+};
+
+}  // namespace framework
+
+extern "C" {
+
+/// @return the counts kept by the allocation counter library
+framework::AllocationCounter *frameworkAllocationCounter();
+
+/// @return tag of what the calling thread is running
+int *frameworkAllocationTag();
+}
+
+#endif  // FRAMEWORK_ALLOCATIONCOUNTER_H_
@@ -0,0 +1,90 @@
+/**
+ * @file Checkpoint.h
+ * @brief Class recording how far a job got, so it can be resumed
+ */
+
+#ifndef FRAMEWORK_CHECKPOINT_H_
+#define FRAMEWORK_CHECKPOINT_H_
+
+// STL
+#include <string>
+
+namespace framework {
+
+/**
+ * @class Checkpoint
+ * @brief Progress of a Process at a point where all of its output is on disk
+ *
+ * A checkpoint is taken between events, after the output trees have been
+ * saved, so everything before it can be recovered from the output files
+ * even if the job is killed. A resumed job starts at the event after
+ * the checkpoint and writes to new files, which can be merged with the
+ * files from the first part of the job.
+ *
+ * The checkpoint is a small text file of "key value" lines. It is written
+ * to a temporary file and then renamed, so there is always a complete
+ * checkpoint on disk.
+ *
+ * The state of random number engines is not saved. The master seed of
+ * the RandomNumberSeedService is kept, so generators seeded per event with
+ * RandomNumberSeedService::getEventSeed give the same events as a job that
+ * was never stopped. Generators seeded once with getSeed would restart
+ * their sequence and repeat the events before the checkpoint, so getSeed
+ * throws when a job without input files is resumed.
+ */
+class Checkpoint {
+ public:
+  /**
+   * Write the checkpoint
+   *
+   * @param fileName name of the checkpoint file
+   */
+  void write(const std::string &fileName) const;
+
+  /**
+   * Read a checkpoint
+   *
+   * @throw Exception if the file can't be read or is incomplete
+   * @param fileName name of the checkpoint file
+   * @return the checkpoint in the file
+   */
+  static Checkpoint read(const std::string &fileName);
+
+  /**
+   * Name a file written by a resumed job
+   *
+   * @param name name of the file in the configuration
+   * @param eventsProcessed number of events processed before resuming
+   * @return name with the number of events inserted before the extension
+   */
+  static std::string resumedFileName(const std::string &name,
+                                     int eventsProcessed);
+
+  /// Number of events processed before the checkpoint
+  int eventsProcessed{0};
+
+  /// Index of the input file being read, negative if there are no inputs
+  int inputFileIndex{-1};
+
+  /// Name of the input file being read
+  std::string inputFile;
+
+  /// Entry in the input file of the next event to process
+  long nextEntry{-1};
+
+  /// Number of events in the output file being written
+  long outputEntries{0};
+
+  /// True if the master seed of the random number seed service is known
+  bool hasMasterSeed{false};
+
+  /// Run the master seed is for
+  int run{0};
+
+  /// Master seed of the random number seed service for that run
+  int masterSeed{0};
+};
+
+}  // namespace framework
+
+#endif  // FRAMEWORK_CHECKPOINT_H_
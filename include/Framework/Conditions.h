@@ -24,7 +24,9 @@
 /*   C++ StdLib   */
 /*~~~~~~~~~~~~~~~~*/
 #include <any>
+#include <atomic>
 #include <map>
+#include <vector>
 
 namespace ldmx {
 class RunHeader;
@@ -35,6 +37,8 @@ namespace framework {
 class Process;
 class ConditionsObjectProvider;
 class ConditionsObject;
+template <class T>
+class ConditionsHandle;
 
 /**
  * @class Conditions
@@ -59,6 +63,11 @@ class Conditions {
    * or is out of date, the ConditionsObjectProvider::getCondition method
    * will be called to provide the object.
    *
+   * Before asking the provider, the other versions kept in the cache
+   * are checked for one that is valid for the event. The returned object
+   * stays valid at least until the next epoch, even if another lookup
+   * evicts it from the cache.
+   *
    * @throws Exception if condition object or provider for that object is not
    * found.
    *
@@ -84,6 +93,49 @@ class Conditions {
     return dynamic_cast<const T&>(*getConditionPtr(condition_name));
   }
 
+  /**
+   * Get a handle to a conditions object
+   *
+   * The handle is meant to be made once, in onProcessStart, and kept.
+   * It looks the object up again only after a new run has started.
+   *
+   * @throws Exception if there is no provider for the condition
+   *
+   * @tparam T type to cast condition object to
+   * @param[in] condition_name name of condition to retrieve
+   * @returns handle to the conditions object
+   */
+  template <class T>
+  ConditionsHandle<T> getConditionsHandle(const std::string& condition_name) {
+    if (providerMap_.find(condition_name) == providerMap_.end()) {
+      EXCEPTION_RAISE(
+          "ConditionUnavailable",
+          std::string("No provider is available for : " + condition_name));
+    }
+    return ConditionsHandle<T>(*this, condition_name);
+  }
+
+  /**
+   * Get the epoch of the conditions
+   *
+   * The epoch changes whenever the run number changes, the only time an
+   * Interval Of Validity can end, so an object that was valid in the
+   * same epoch is still valid.
+   *
+   * @returns current epoch, never zero
+   */
+  unsigned long getEpoch() const { return epoch_; }
+
+  /**
+   * Start a new epoch, so handles look their objects up again
+   *
+   * Called by onNewRun and by the Process whenever the run number
+   * changes, even if no RunHeader was found for the new run. No event
+   * is being processed then, so the versions evicted from the cache
+   * during the last epoch are released to their providers here.
+   */
+  void newEpoch();
+
   /**
    * Access the IOV for the given condition
    *
@@ -92,6 +144,13 @@ class Conditions {
    */
   ConditionsIOV getConditionIOV(const std::string& condition_name) const;
 
+  /**
+   * Make a table of how often each condition was found in the cache
+   *
+   * @returns lookups that hit and missed the cache of each condition
+   */
+  std::string summary() const;
+
   /**
    * Calls onProcessStart for all ConditionsObjectProviders
    */
@@ -122,19 +181,168 @@ class Conditions {
   std::map<std::string, ConditionsObjectProvider*> providerMap_;
 
   /**
-   * An entry to store an already loaded conditions object
+   * A version of a conditions object that has been loaded
    */
-  struct CacheEntry {
-    /// Interval Of Validity for this entry in the cache
+  struct Version {
+    /// Interval Of Validity for this version
     ConditionsIOV iov;
-    /// Provider that gave us the conditions object
-    ConditionsObjectProvider* provider;
     /// Const pointer to the retrieved conditions object
     const ConditionsObject* obj;
+    /// Number of the lookup that last used this version
+    unsigned long lastUsed;
+  };
+
+  /**
+   * An entry to store the already loaded versions of a conditions object
+   */
+  struct CacheEntry {
+    /// Provider that gave us the conditions object
+    ConditionsObjectProvider* provider;
+    /// Loaded versions, at most the cache size of the provider
+    std::vector<Version> versions;
+    /// Index of the version used last
+    std::size_t current{0};
+    /// Number of lookups that found a loaded version
+    long hits{0};
+    /// Number of lookups that asked the provider
+    long misses{0};
+    /// True once the provider has given an object, later requests reload it
+    bool loaded{false};
   };
 
   /** Conditions cache */
   std::map<std::string, CacheEntry> cache_;
+
+  /** Number of lookups done, used to find the least recently used version */
+  unsigned long lookups_{0};
+
+  /**
+   * Versions evicted from the cache that haven't been released yet
+   *
+   * Another stream may still be reading an evicted object, so they are
+   * only given back to their providers at the start of the next epoch.
+   */
+  std::vector<std::pair<ConditionsObjectProvider*, const ConditionsObject*>>
+      evicted_;
+
+  /**
+   * Give the evicted versions back to their providers
+   */
+  void releaseEvicted();
+
+  /**
+   * Epoch of the conditions, changed by newEpoch
+   *
+   * This isn't atomic so the Process stays movable. It is only written
+   * by the thread running Process::run, when the run number changes.
+   * That happens between events, when no stream has an event in flight,
+   * so it is never written while handles on other threads read it.
+   */
+  unsigned long epoch_{1};
+};
+
+/**
+ * @class ConditionsHandle
+ * @brief Handle to a conditions object for fast access in every event
+ *
+ * Looking a condition up by name takes a map lookup, a check of its
+ * Interval Of Validity and a dynamic_cast. The handle keeps the pointer
+ * it found with the epoch of the conditions it found it in, so in every
+ * other event it only compares the epoch.
+ *
+ * A handle can be shared by the streams of a processor; when several
+ * of them find the epoch changed, they all look up the same object.
+ *
+ * @tparam T type of the conditions object
+ */
+template <class T>
+class ConditionsHandle {
+ public:
+  /**
+   * Default constructor, for handles that are set in onProcessStart
+   */
+  ConditionsHandle() = default;
+
+  /**
+   * Constructor
+   *
+   * @param[in] conditions Conditions to look the object up in
+   * @param[in] name name of the condition
+   */
+  ConditionsHandle(Conditions& conditions, const std::string& name)
+      : conditions_{&conditions}, name_{name} {}
+
+  /**
+   * Copy constructor, the copy looks the object up again
+   *
+   * @param[in] other handle to copy
+   */
+  ConditionsHandle(const ConditionsHandle& other)
+      : conditions_{other.conditions_}, name_{other.name_} {}
+
+  /**
+   * Copy assignment, the copy looks the object up again
+   *
+   * @param[in] other handle to copy
+   * @returns this handle
+   */
+  ConditionsHandle& operator=(const ConditionsHandle& other) {
+    conditions_ = other.conditions_;
+    name_ = other.name_;
+    epoch_.store(0, std::memory_order_relaxed);
+    return *this;
+  }
+
+  /**
+   * Get the conditions object for the current event
+   *
+   * @throws Exception if the handle was never set or the object
+   * can't be found for this event
+   *
+   * @returns const reference to conditions object
+   */
+  const T& get() const {
+    if (conditions_ == nullptr) {
+      EXCEPTION_RAISE("ConditionUnavailable",
+                      "Conditions handle was used before it was set.");
+    }
+    unsigned long epoch{conditions_->getEpoch()};
+    if (epoch_.load(std::memory_order_acquire) != epoch) refresh(epoch);
+    return *object_.load(std::memory_order_relaxed);
+  }
+
+  /// @see get
+  const T& operator*() const { return get(); }
+
+  /// @see get
+  const T* operator->() const { return &get(); }
+
+  /// @returns name of the condition
+  const std::string& getName() const { return name_; }
+
+ private:
+  /**
+   * Look the object up again after the epoch changed
+   *
+   * @param[in] epoch epoch of the conditions being looked up in
+   */
+  void refresh(unsigned long epoch) const {
+    object_.store(&conditions_->getCondition<T>(name_),
+                  std::memory_order_relaxed);
+    epoch_.store(epoch, std::memory_order_release);
+  }
+
+  /// Conditions to look the object up in
+  Conditions* conditions_{nullptr};
+
+  /// Name of the condition
+  std::string name_;
+
+  /// Object found in the last lookup
+  mutable std::atomic<const T*> object_{nullptr};
+
+  /// Epoch of the last lookup, zero before the first one
+  mutable std::atomic<unsigned long> epoch_{0};
 };
 
 }  // namespace framework
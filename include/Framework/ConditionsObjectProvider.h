@@ -126,6 +126,16 @@ class ConditionsObjectProvider {
    */
   const std::string& getTagName() const { return tagname_; }
 
+  /**
+   * Access the number of versions of the object to keep in the cache
+   *
+   * Versions are kept for different Intervals Of Validity so that input
+   * which goes back and forth between runs doesn't load them again.
+   * The least recently used version is evicted when there are more, and
+   * released when the run changes, once no event can still be reading it.
+   */
+  int getCacheSize() const { return cacheSize_; }
+
  protected:
   /** Request another condition needed to construct this condition */
   std::pair<const ConditionsObject*, ConditionsIOV> requestParentCondition(
@@ -146,6 +156,9 @@ class ConditionsObjectProvider {
 
   /** The tag name for the ConditionsObjectProvider. */
   std::string tagname_;
+
+  /** The number of versions of the object to keep in the cache. */
+  int cacheSize_;
 };
 
 }  // namespace framework
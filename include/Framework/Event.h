@@ -16,15 +16,22 @@
 
 // LDMX
 #include "Framework/Exception/Exception.h"
+#include "Framework/ProductHandle.h"
 #include "Framework/ProductTag.h"
 
 // STL
 #include <regex.h>
 #include <algorithm>
+#include <deque>
+#include <functional>
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <set>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <variant>
 
 namespace framework {
@@ -103,10 +110,11 @@ class Event {
    * @param passName The process pass label which was in use when this object
    * was put into the event, such as "sim" or "rerecov2".
    * @return True if the object or collection *uniquely* exists in the event.
+   *
+   * The names are compared exactly and case-sensitively, use searchProducts
+   * to match them with regular expressions.
    */
-  bool exists(const std::string &name, const std::string &passName) const {
-    return (searchProducts(name, passName, "").size() == 1);
-  }
+  bool exists(const std::string &name, const std::string &passName) const;
 
   /**
    * Add a drop rule to the list of regex expressions to drop.
@@ -118,80 +126,100 @@ class Event {
    */
   void addDrop(const std::string &exp);
 
+  /**
+   * Add a rule for the settings of output branches.
+   *
+   * Branches made for products whose branch name matches the regex are
+   * created with the input basket size and split level. Branches copied
+   * from the input tree that match have their basket size changed (the
+   * split level of an existing branch cannot be changed).
+   *
+   * The rules are checked in the order they are added and the last
+   * matching rule is used, so you can go from something more general
+   * to something more specific.
+   *
+   * @param exp regex to match
+   * @param basketSize size of baskets in bytes for matching branches
+   * @param splitLevel split level for matching branches
+   */
+  void addBranchRule(const std::string &exp, int basketSize, int splitLevel);
+
   /**
    * Adds an object to the event bus
+   *
+   * The object is copied into the event bus storage.
+   *
    * @param collectionName
    * @param obj in ROOT dictionary to add
+   * @param sortPolicy How to order the object if it is a collection
    */
   template <typename T>
-  void add(const std::string &collectionName, T &obj) {
-    if (collectionName.find('_') != std::string::npos) {
-      EXCEPTION_RAISE("IllegalName",
-                      "The product name '" + collectionName +
-                          "' is illegal as it contains an underscore.");
-    }
-
-    std::string branchName;
-    if (collectionName == ldmx::EventHeader::BRANCH)
-      branchName = collectionName;
-    else
-      branchName = makeBranchName(collectionName);
+  void add(const std::string &collectionName, T &obj,
+           SortPolicy sortPolicy = SortPolicy::Sort) {
+    addImpl<std::remove_const_t<T> >(collectionName, obj, sortPolicy);
+  }
 
-    if (branchesFilled_.find(branchName) != branchesFilled_.end()) {
-      EXCEPTION_RAISE("ProductExists",
-                      "A product named '" + collectionName +
-                          "' already exists in the event (has been loaded by a "
-                          "previous producer in this process).");
-    }
-    branchesFilled_.insert(branchName);
-    // MEMORY add is leaking memory when given a vector (possible upon
-    // destruction of Event?) MEMORY add is 'conditional jump or move depends on
-    // uninitialised values' for all types of objects
-    //  TTree::BranchImpRef or TTree::BronchExec
-    if (passengers_.find(branchName) == passengers_.end()) {
-      // create a new branch for this collection
-      // TODO check if input type is listed as an EventBusPassenger?
-      passengers_[branchName] = EventBusPassenger(obj);
-      T *passengerAddress = std::get_if<T>(&passengers_[branchName]);
-      std::string tname =
-          typeid(obj)
-              .name();  // type name (want to use branch element if possible)
-      if (outputTree_ != 0 and not shouldDrop(branchName)) {
-        TBranchElement *outBranch = dynamic_cast<TBranchElement *>(
-            outputTree_->GetBranch(branchName.c_str()));
-        if (outBranch) {
-          // branch already exists, just reset branch object
-          outBranch->SetObject(passengerAddress);
-        } else {
-          // branch doesnt exist, make new one
-          outBranch = dynamic_cast<TBranchElement *>(outputTree_->Branch(
-              branchName.c_str(), passengerAddress, 100000, 3));
-        }
-        newBranches_.push_back(outBranch);
-        // get type name from branch if possible, otherwise use compiler level
-        // type name (above)
-        tname = outBranch->GetClassName();
-      }  // output tree exists or not
-      products_.emplace_back(collectionName, passName_, tname);
-      branchNames_.push_back(branchName);
-      knownLookups_.clear();  // have to invalidate this cache
-    }
+  /**
+   * Adds a temporary object to the event bus
+   *
+   * The object is moved into the event bus storage instead of copied,
+   * so it is left in a valid but unspecified state afterwards.
+   *
+   * @param collectionName
+   * @param obj in ROOT dictionary to add
+   * @param sortPolicy How to order the object if it is a collection
+   */
+  template <typename T>
+  void add(const std::string &collectionName, T &&obj,
+           SortPolicy sortPolicy = SortPolicy::Sort) {
+    addImpl<T>(collectionName, std::move(obj), sortPolicy);
+  }
 
-    // copy input contents into bus passenger
-    EventBusPassenger toAdd(obj);
-    if (toAdd.index() == passengers_[branchName].index()) {
-      std::visit(sortPassenger(), toAdd);  // sort before copying over
-      passengers_[branchName] = toAdd;
-    } else {
-      EXCEPTION_RAISE("TypeMismatch",
-                      "Attempting to add an object whose type '" +
-                          std::string(typeid(obj).name()) +
-                          "' doesn't match the type stored in the collection.");
-    }
+  /**
+   * Adds an object to the event bus using a declared handle
+   *
+   * The first time the handle is used after the bus is reset, this goes
+   * through the named add to create the passenger and output branch.
+   * After that, it is just an index into the slot table.
+   *
+   * The object is ordered according to the sort policy of the handle.
+   *
+   * @param handle ProductHandle for this product, usually from
+   * EventProcessor::produces
+   * @param obj in ROOT dictionary to add
+   */
+  template <typename T>
+  void add(const ProductHandle<T> &handle, T &obj) {
+    addImpl(handle, obj);
+  }
 
-    return;
+  /**
+   * Adds a temporary object to the event bus using a declared handle
+   *
+   * @see add(const ProductHandle<T>&, T&) for how the handle is used
+   * @see add(const std::string&, T&&) for the state of obj afterwards
+   *
+   * @param handle ProductHandle for this product, usually from
+   * EventProcessor::produces
+   * @param obj in ROOT dictionary to add
+   */
+  template <typename T>
+  void add(const ProductHandle<T> &handle, T &&obj) {
+    addImpl(handle, std::move(obj));
   }
 
+  /**
+   * Move the products added to another event bus during this event
+   * onto this one
+   *
+   * Used when events are processed on separate event buses and then
+   * written through one. The products are moved without being sorted
+   * again, and the EventHeader is left alone.
+   *
+   * @param other Event to take the products from
+   */
+  void takeProducts(Event &other);
+
   /**
    * Get a list of products which match the given POSIX-Extended,
    * case-insenstive regular-expressions. An empty argument is interpreted as
@@ -199,6 +227,9 @@ class Event {
    * @param namematch Regular expression to compare with the product name
    * @param passmatch Regular expression to compare with the pass name
    * @param typematch Regular expression to compare with the type name
+   *
+   * The result of each query is remembered until the list of products
+   * changes, so repeating a search every event is just a lookup.
    */
   std::vector<ProductTag> searchProducts(const std::string &namematch,
                                          const std::string &passmatch,
@@ -206,10 +237,17 @@ class Event {
 
   /**
    * Get a general object from the event bus
+   *
+   * The returned reference points directly into the event bus storage,
+   * so no copy of the object is made. It remains valid until the event
+   * bus is reset at the end of the current input file, but its contents
+   * are updated when the next event is read.
+   *
+   * @return const reference to the object on the event bus
    */
   template <typename T>
-  const T getObject(const std::string &collectionName,
-                    const std::string &passName) const {
+  const T &getObject(const std::string &collectionName,
+                     const std::string &passName) const {
     return getImpl<T>(collectionName, passName);
   }
 
@@ -217,16 +255,100 @@ class Event {
    * Get a general object from the event bus when you don't care about the pass
    */
   template <typename T>
-  const T getObject(const std::string &collectionName) const {
+  const T &getObject(const std::string &collectionName) const {
     return getObject<T>(collectionName, "");
   }
 
+  /**
+   * Get a general object from the event bus using a declared handle
+   *
+   * The first time the handle is used after the bus is reset, this goes
+   * through the named lookup. After that, it is just an index into the
+   * slot table.
+   *
+   * @see getObject for the lifetime of the returned reference
+   * @param handle ProductHandle for this product, usually from
+   * EventProcessor::consumes
+   */
+  template <typename T>
+  const T &getObject(const ProductHandle<T> &handle) const {
+    if (not onDemand_.empty())
+      requestOnDemand(handle.name(), handle.passName());
+    auto lock{lockBus()};
+    ProductSlot &slot{slotFor(handle, false)};
+    if (slot.passenger == nullptr) {
+      const T &obj{getImpl<T>(handle.name(), handle.passName())};
+      bindSlot(slot, resolveBranchName(handle.name(), handle.passName()));
+      return obj;
+    }
+
+    if (slot.branch and slot.branch->GetReadEntry() != ientry_) {
+      readEntry(slot.branch, ientry_);
+    }
+    return std::get<T>(*slot.passenger);
+  }
+
+  /**
+   * Get a general object from the event bus if it is there
+   *
+   * Unlike getObject, nothing is thrown if the product isn't found,
+   * so this is the way to read products that are optional.
+   *
+   * @see getObject for the lifetime of the returned object
+   * @throw Exception if the pass name is empty and more than one pass
+   * made this product
+   * @return pointer to the object on the event bus, null if there is none
+   */
+  template <typename T>
+  const T *tryGetObject(const std::string &collectionName,
+                        const std::string &passName) const {
+    return findImpl<T>(collectionName, passName);
+  }
+
+  /**
+   * Get a general object from the event bus if it is there when you don't
+   * care about the pass
+   */
+  template <typename T>
+  const T *tryGetObject(const std::string &collectionName) const {
+    return tryGetObject<T>(collectionName, "");
+  }
+
+  /**
+   * Get a general object from the event bus if it is there using a
+   * declared handle
+   *
+   * @see getObject(const ProductHandle<T> &) for how the handle is used
+   * @param handle ProductHandle for this product
+   * @return pointer to the object on the event bus, null if there is none
+   */
+  template <typename T>
+  const T *tryGetObject(const ProductHandle<T> &handle) const {
+    if (not onDemand_.empty())
+      requestOnDemand(handle.name(), handle.passName());
+    auto lock{lockBus()};
+    ProductSlot &slot{slotFor(handle, false)};
+    if (slot.passenger == nullptr) {
+      const T *obj{findImpl<T>(handle.name(), handle.passName())};
+      if (obj)
+        bindSlot(slot, resolveBranchName(handle.name(), handle.passName()));
+      return obj;
+    }
+
+    if (slot.branch and slot.branch->GetReadEntry() != ientry_) {
+      readEntry(slot.branch, ientry_);
+    }
+    return &std::get<T>(*slot.passenger);
+  }
+
   /**
    * Get a collection (std::vector) of objects from the event bus
+   *
+   * @see getObject for the lifetime of the returned reference
    */
   template <typename T>
-  const std::vector<T> getCollection(const std::string &collectionName,
-                                     const std::string &passName) const {
+  const std::vector<T> &getCollection(const std::string &collectionName,
+                                      const std::string &passName) const {
     return getObject<std::vector<T> >(collectionName, passName);
   }
 
@@ -235,16 +357,18 @@ class Event {
    * care about the pass
    */
   template <typename T>
-  const std::vector<T> getCollection(const std::string &collectionName) const {
+  const std::vector<T> &getCollection(const std::string &collectionName) const {
     return getCollection<T>(collectionName, "");
   }
 
   /**
    * Get a map (std::map) of objects from the event bus
+   *
+   * @see getObject for the lifetime of the returned reference
    */
   template <typename Key, typename Val>
-  const std::map<Key, Val> getMap(const std::string &collectionName,
-                                  const std::string &passName) const {
+  const std::map<Key, Val> &getMap(const std::string &collectionName,
+                                   const std::string &passName) const {
     return getObject<std::map<Key, Val> >(collectionName, passName);
   }
 
@@ -252,7 +376,7 @@ class Event {
    * Get a map of objects from the event bus when you don't care about the pass
    */
   template <typename Key, typename Val>
-  const std::map<Key, Val> getMap(const std::string &collectionName) const {
+  const std::map<Key, Val> &getMap(const std::string &collectionName) const {
     return getMap<Key, Val>(collectionName, "");
   }
 
@@ -261,112 +385,85 @@ class Event {
    * Get an event passenger from the event bus (actual implementation)
    * @param collectionName name of collection you want
    * @param passName name of pass you want
+   * @return const reference to the passenger on the event bus
    */
   template <typename T>
-  T getImpl(const std::string &collectionName,
-            const std::string &passName) const {
-    // get branch name
-    std::string branchName;
-    if (collectionName == ldmx::EventHeader::BRANCH)
-      branchName = collectionName;
-    else
-      branchName = makeBranchName(collectionName, passName);
-
-    // if no passName, then find branchName by looking over known branches
-    if (passName.empty() && collectionName != ldmx::EventHeader::BRANCH) {
-      auto itKL = knownLookups_.find(collectionName);
-      if (itKL != knownLookups_.end())
-        branchName = itKL->second;
-      else {
-        // this collecitonName hasn't been found before
-        std::vector<std::vector<std::string>::const_iterator> matches;
-        branchName = collectionName + "_";
-        for (auto itBN = branchNames_.begin(); itBN != branchNames_.end();
-             itBN++) {
-          if (!itBN->compare(0, branchName.size(), branchName))
-            matches.push_back(itBN);
-        }
-        if (matches.empty()) {
-          // no matches found
-          EXCEPTION_RAISE("ProductNotFound",
-                          "No product found for name '" + collectionName + "'");
-        } else if (matches.size() > 1) {
-          // more than one branch found
-          std::string names;
-          for (auto strs : matches) {
-            if (!names.empty()) names += ", ";
-            names += *strs;
-          }
-          EXCEPTION_RAISE("ProductAmbiguous",
-                          "Multiple products found for name '" +
-                              collectionName +
-                              "' without specified pass name (" + names + ")");
-        } else {
-          // exactly one branch found
-          branchName = *matches.front();
-          knownLookups_[collectionName] = branchName;
-        }
-      }
+  const T &getImpl(const std::string &collectionName,
+                   const std::string &passName) const {
+    const T *passenger{findImpl<T>(collectionName, passName)};
+    if (passenger == nullptr) {
+      EXCEPTION_RAISE("ProductNotFound", "No product found for name '" +
+                                             collectionName + "' and pass '" +
+                                             passName + "'");
     }
+    return *passenger;
+  }  // getImpl
+
+  /**
+   * Find an event passenger on the event bus, loading it from the
+   * input tree if it hasn't been read yet
+   * @param collectionName name of collection you want
+   * @param passName name of pass you want
+   * @return pointer to the passenger on the event bus, null if not found
+   */
+  template <typename T>
+  const T *findImpl(const std::string &collectionName,
+                    const std::string &passName) const {
+    if (not onDemand_.empty()) requestOnDemand(collectionName, passName);
+    auto lock{lockBus()};
+    std::string branchName;
+    if (not findBranchName(collectionName, passName, branchName))
+      return nullptr;
 
     // get iterators to branch and collection
     auto itBranch = branches_.find(branchName);
     auto itPassenger = passengers_.find(branchName);
 
     if (itPassenger != passengers_.end()) {
-      if (itBranch != branches_.end()) {
-        // passenger and branch found
-        itBranch->second->GetEntry(ientry_);
-        // reading branches from input tree need to be manually updated
-        passengers_[branchName] = *((T *)(itBranch->second->GetObject()));
+      if (itBranch != branches_.end() and
+          itBranch->second->GetReadEntry() != ientry_) {
+        // passenger is bound to an input branch,
+        // so reading the entry updates the passenger in place
+        readEntry(itBranch->second, ientry_);
       }
-      return std::get<T>(itPassenger->second);
+      return &std::get<T>(itPassenger->second);
     } else if (inputTree_ == 0) {
       // not found in loaded branches and there is no inputTree,
       // so no hope of finding an unloaded object
-      EXCEPTION_RAISE("ProductNotFound", "No product found for name '" +
-                                             collectionName + "' and pass '" +
-                                             passName_ + "'");
+      return nullptr;
     }
 
-    // find the active branch and update if necessary
-    if (itBranch != branches_.end()) {
-      // update buffers if needed
-      if (itBranch->second->GetReadEntry() != ientry_) {
-        itBranch->second->GetEntry(ientry_, 1);
-      }
+    // ok, maybe we've not loaded this yet, look for a branch
+    TBranchElement *branch = dynamic_cast<TBranchElement *>(
+        inputTree_->GetBranch(branchName.c_str()));
+    if (branch == 0) {
+      // inputTree doesn't have that branch
+      return nullptr;
+    }
 
-      // check the objects map
-      if (itPassenger != passengers_.end())
-        return std::get<T>(itPassenger->second);
-
-      // this case is hard (impossible?) to achieve
-      EXCEPTION_RAISE(
-          "ProductNotFound",
-          "A branch mis-match occurred. I'm not sure how I got here!");
-    } else {
-      // ok, maybe we've not loaded this yet, look for a branch
-      TBranchElement *branch = dynamic_cast<TBranchElement *>(
-          inputTree_->GetBranch(branchName.c_str()));
-      if (branch == 0) {
-        // inputTree doesn't have that branch
-        EXCEPTION_RAISE("ProductNotFound", "No product found for name '" +
-                                               collectionName + "' and pass '" +
-                                               passName_ + "'");
-      }
-      // ooh, new branch!
-      // load in the current entry
-      branch->SetStatus(1);  // overrides any 'ignore' rules
-      branch->GetEntry((ientry_ < 0) ? (0) : (ientry_));
+    // ooh, new branch!
+    // create the passenger and bind the branch directly to it, so reading
+    // an entry deserializes straight into the event bus without a copy
+    //  the passenger map never moves its nodes, so this address is stable
+    //  until the bus is reset at the end of the file
+    T *passengerAddress = &makePassenger<T>(branchName);
+    branch->SetStatus(1);  // overrides any 'ignore' rules
+    branch->SetObject(passengerAddress);
+
+    // output branches cloned from this input branch were pointing at the
+    // object ROOT allocated for the input branch, so they need to follow
+    if (outputTree_) {
+      TBranchElement *outBranch = dynamic_cast<TBranchElement *>(
+          outputTree_->GetBranch(branchName.c_str()));
+      if (outBranch) outBranch->SetObject(passengerAddress);
+    }
 
-      // insert into maps of loaded branches and passengers
-      passengers_[branchName] = *((
-          T *)(branch->GetObject()));  // this will fail if wrong type is passed
-      branches_[branchName] = branch;
+    // load in the current entry
+    readEntry(branch, (ientry_ < 0) ? (0) : (ientry_));
+    branches_[branchName] = branch;
 
-      return std::get<T>(passengers_.at(branchName));
-    }
-  }  // getImpl
+    return passengerAddress;
+  }  // findImpl
 
  public:
   /** ********* Functionality for storage  ********** **/
@@ -425,6 +522,10 @@ class Event {
 
   /**
    * Clear this object's data (including passengers).
+   *
+   * The collections are cleared without releasing their memory, so
+   * the next event can fill them without reallocating. The memory held
+   * by the passengers is recorded for the high-water mark before clearing.
    */
   void Clear();
 
@@ -438,6 +539,8 @@ class Event {
    *
    * Clears buffer objects and resets output branch addresses.
    * This prepares the event bus for a new input file (with new addresses).
+   * The storage of the passengers is kept aside and reused when the
+   * same products show up in the next file.
    */
   void onEndOfFile();
 
@@ -459,7 +562,434 @@ class Event {
     electronCount_ = electronCount; 
   }
 
+  /**
+   * Get the largest amount of memory held by the event bus passengers
+   * at the end of any event so far.
+   *
+   * This is an estimate from the capacity of the collections, it does
+   * not include memory allocated by the objects within them.
+   *
+   * @return high-water mark of event bus memory in bytes
+   */
+  std::size_t getBusHighWaterMark() const { return busHighWaterMark_; }
+
+  /**
+   * Add time that was spent waiting for the input file to be read
+   *
+   * Used by EventFile to include the reading of whole entries.
+   *
+   * @param seconds time spent waiting
+   */
+  void addInputStallTime(double seconds) { inputStallTime_ += seconds; }
+
+  /**
+   * Get the total time spent waiting for the input file to be read
+   *
+   * This includes reading whole entries in EventFile and loading
+   * single branches when they are requested.
+   *
+   * @return time spent waiting on input in seconds
+   */
+  double getInputStallTime() const { return inputStallTime_; }
+
+  /**
+   * Guard the event bus so that several processors can use it at once
+   *
+   * This is needed when independent processors in the sequence are run
+   * in parallel on the same event. Otherwise, the bus is not locked.
+   *
+   * @param concurrent true if the bus may be used by several threads
+   */
+  void setConcurrentAccess(bool concurrent) { concurrentAccess_ = concurrent; }
+
+  /**
+   * Register a producer that only runs when its products are requested
+   *
+   * The producer is run the first time in each event that one of its
+   * products is requested from this event bus, or when runOnDemand is
+   * called. It runs at most once per event.
+   *
+   * @param collectionNames names of the products the producer adds
+   * @param produce function running the producer on this event
+   * @return index of the producer for runOnDemand
+   */
+  std::size_t addOnDemand(const std::vector<std::string> &collectionNames,
+                          std::function<void()> produce);
+
+  /**
+   * Run an on-demand producer unless it already ran during this event
+   *
+   * @param index index of the producer returned by addOnDemand
+   */
+  void runOnDemand(std::size_t index) const;
+
+  /**
+   * Check if a product added in this pass is written to the output
+   *
+   * @param collectionName name of the product
+   * @return true if there is an output tree and the product isn't dropped
+   */
+  bool isPersisted(const std::string &collectionName) const;
+
  private:
+  /**
+   * Lock the event bus if it may be used by several threads
+   *
+   * The lock is recursive since the handle forms of add and get go
+   * through the named forms the first time they are used.
+   *
+   * @return lock on the bus, empty if concurrent access is off
+   */
+  std::unique_lock<std::recursive_mutex> lockBus() const {
+    if (not concurrentAccess_) return std::unique_lock<std::recursive_mutex>();
+    return std::unique_lock<std::recursive_mutex>(busMutex_);
+  }
+
+  /**
+   * Run the on-demand producer of a product if it hasn't run yet
+   *
+   * The bus isn't locked while the producer runs, so the producer may
+   * run processors that are guarded by their own lock.
+   *
+   * @param collectionName name of the product being requested
+   * @param passName pass name of the product being requested
+   */
+  void requestOnDemand(const std::string &collectionName,
+                       const std::string &passName) const;
+
+  /**
+   * A producer that only runs when its products are requested
+   */
+  struct OnDemandProducer {
+    /// Function running the producer on this event
+    std::function<void()> produce;
+    /// True if the producer was run during this event
+    bool triggered{false};
+    /// Guard so that the producer is run once when requested at once
+    std::recursive_mutex running;
+  };
+
+  /**
+   * Add an object to the event bus (actual implementation)
+   *
+   * The passenger is created in place the first time this product is
+   * added and then the object is assigned into it, so a copy is only made
+   * if the input object is an lvalue.
+   *
+   * @tparam T type of the product (without any reference or const)
+   * @tparam Obj forwarded type of input object
+   * @param collectionName name of product
+   * @param obj object to copy or move onto the bus
+   * @param sortPolicy How to order the object if it is a collection
+   */
+  template <typename T, typename Obj>
+  void addImpl(const std::string &collectionName, Obj &&obj,
+               SortPolicy sortPolicy) {
+    auto lock{lockBus()};
+    if (collectionName.find('_') != std::string::npos) {
+      EXCEPTION_RAISE("IllegalName",
+                      "The product name '" + collectionName +
+                          "' is illegal as it contains an underscore.");
+    }
+
+    std::string branchName;
+    if (collectionName == ldmx::EventHeader::BRANCH)
+      branchName = collectionName;
+    else
+      branchName = makeBranchName(collectionName);
+
+    if (branchesFilled_.find(branchName) != branchesFilled_.end()) {
+      EXCEPTION_RAISE("ProductExists",
+                      "A product named '" + collectionName +
+                          "' already exists in the event (has been loaded by a "
+                          "previous producer in this process).");
+    }
+    branchesFilled_.insert(branchName);
+    markSlotFilled(branchName);
+    // MEMORY add is leaking memory when given a vector (possible upon
+    // destruction of Event?) MEMORY add is 'conditional jump or move depends on
+    // uninitialised values' for all types of objects
+    //  TTree::BranchImpRef or TTree::BronchExec
+    auto itPassenger = passengers_.find(branchName);
+    if (itPassenger == passengers_.end()) {
+      // create a new branch for this collection
+      // TODO check if input type is listed as an EventBusPassenger?
+      T *passengerAddress = &makePassenger<T>(branchName);
+      itPassenger = passengers_.find(branchName);
+      std::string tname =
+          typeid(T).name();  // type name (want to use branch element if possible)
+      if (outputTree_ != 0 and not shouldDrop(branchName)) {
+        TBranchElement *outBranch = dynamic_cast<TBranchElement *>(
+            outputTree_->GetBranch(branchName.c_str()));
+        if (outBranch) {
+          // branch already exists, just reset branch object
+          outBranch->SetObject(passengerAddress);
+        } else {
+          // branch doesnt exist, make new one
+          const BranchRule &settings{getBranchRule(branchName)};
+          outBranch = dynamic_cast<TBranchElement *>(
+              outputTree_->Branch(branchName.c_str(), passengerAddress,
+                                  settings.basketSize, settings.splitLevel));
+        }
+        newBranches_.push_back(outBranch);
+        // get type name from branch if possible, otherwise use compiler level
+        // type name (above)
+        tname = outBranch->GetClassName();
+      }  // output tree exists or not
+      addProduct(collectionName, passName_, tname);
+      branchNames_.push_back(branchName);
+    }
+
+    // copy or move input contents into bus passenger
+    //  assigning into the held alternative keeps the passenger address
+    //  (which the output branch points to) the same
+    if (not std::holds_alternative<T>(itPassenger->second)) {
+      EXCEPTION_RAISE("TypeMismatch",
+                      "Attempting to add an object whose type '" +
+                          std::string(typeid(T).name()) +
+                          "' doesn't match the type stored in the collection.");
+    }
+    T &passenger{std::get<T>(itPassenger->second)};
+    passenger = std::forward<Obj>(obj);
+    sortPassenger{sortPolicy}(passenger);
+  }
+
+  /**
+   * Add an object to the event bus using a declared handle (actual
+   * implementation)
+   *
+   * @tparam T type of the product
+   * @tparam Obj forwarded type of input object
+   * @param handle ProductHandle for this product
+   * @param obj object to copy or move onto the bus
+   */
+  template <typename T, typename Obj>
+  void addImpl(const ProductHandle<T> &handle, Obj &&obj) {
+    auto lock{lockBus()};
+    ProductSlot &slot{slotFor(handle, true)};
+    if (slot.passenger == nullptr) {
+      addImpl<T>(handle.name(), std::forward<Obj>(obj), handle.sortPolicy());
+      bindSlot(slot, handle.name() == ldmx::EventHeader::BRANCH
+                         ? handle.name()
+                         : makeBranchName(handle.name()));
+      slot.filled = true;
+      return;
+    }
+
+    if (slot.filled) {
+      EXCEPTION_RAISE("ProductExists",
+                      "A product named '" + handle.name() +
+                          "' already exists in the event (has been loaded by a "
+                          "previous producer in this process).");
+    }
+
+    if (not std::holds_alternative<T>(*slot.passenger)) {
+      EXCEPTION_RAISE("TypeMismatch",
+                      "Attempting to add an object whose type '" +
+                          std::string(typeid(T).name()) +
+                          "' doesn't match the type stored in the collection.");
+    }
+
+    // recorded like the named add, so the product is written and
+    //  moved between event buses the same way
+    branchesFilled_.insert(slot.branchName);
+    slot.filled = true;
+    T &passenger{std::get<T>(*slot.passenger)};
+    passenger = std::forward<Obj>(obj);
+    sortPassenger{handle.sortPolicy()}(passenger);
+  }
+
+  /**
+   * Read an entry of an input branch into its passenger
+   *
+   * The time spent reading is added to the input stall time.
+   *
+   * @param branch input branch to read
+   * @param entry entry to read
+   */
+  void readEntry(TBranchElement *branch, Long64_t entry) const;
+
+  /**
+   * Add a product to the list of products and the catalog
+   *
+   * This invalidates the caches of lookups into the list of products.
+   *
+   * @param name Name of the product
+   * @param passName Pass name of the product
+   * @param typeName Type name of the product
+   */
+  void addProduct(const std::string &name, const std::string &passName,
+                  const std::string &typeName);
+
+  /**
+   * Create the passenger for a branch
+   *
+   * If a passenger of the same type was used for this branch in a previous
+   * input file, its storage is put back on the bus instead of allocating
+   * a new one, so collections keep the capacity they grew to.
+   *
+   * @tparam T type of the passenger
+   * @param branchName name of branch to create passenger for
+   * @return reference to the new passenger
+   */
+  template <typename T>
+  T &makePassenger(const std::string &branchName) const {
+    auto spare = sparePassengers_.extract(branchName);
+    if (spare and std::holds_alternative<T>(spare.mapped())) {
+      auto inserted = passengers_.insert(std::move(spare));
+      return std::get<T>(inserted.position->second);
+    }
+    return passengers_[branchName].template emplace<T>();
+  }
+
+  /**
+   * Move all of the passengers off of the bus into the spare storage
+   *
+   * The passengers are cleared but not deallocated, so they can be
+   * reused by makePassenger.
+   */
+  void retirePassengers();
+
+  /**
+   * Get the name of the branch for a product
+   *
+   * If the pass name is empty, we look through the known branches for
+   * exactly one product with the input collection name.
+   *
+   * @throw Exception if no product or more than one product is found
+   *
+   * @param collectionName name of collection you want
+   * @param passName name of pass you want
+   * @return name of the branch holding that product
+   */
+  std::string resolveBranchName(const std::string &collectionName,
+                                const std::string &passName) const;
+
+  /**
+   * Find the name of the branch for a product
+   *
+   * Same as resolveBranchName, except that not finding the product
+   * is not an error.
+   *
+   * @throw Exception if more than one product is found
+   *
+   * @param collectionName name of collection you want
+   * @param passName name of pass you want
+   * @param[out] branchName name of the branch holding that product
+   * @return false if no product was found
+   */
+  bool findBranchName(const std::string &collectionName,
+                      const std::string &passName,
+                      std::string &branchName) const;
+
+  /**
+   * An entry in the slot table that handles are resolved to
+   */
+  struct ProductSlot {
+    /// Name of the product
+    std::string collectionName;
+    /// Pass name of the product as requested by the handle
+    std::string passName;
+    /// True if this slot is written to by a producer in this pass
+    bool produced{false};
+    /// Name of the branch the slot is bound to
+    std::string branchName;
+    /// Passenger holding the product, null until first use after a reset
+    EventBusPassenger *passenger{nullptr};
+    /// Input branch bound to the passenger, null if it is not read in
+    TBranchElement *branch{nullptr};
+    /// True if this slot has been added to during this event
+    bool filled{false};
+  };
+
+  /**
+   * Get the slot for a handle, resolving the handle if this is the
+   * first time it is used with this event bus
+   *
+   * @param handle ProductHandle to get slot for
+   * @param produced true if the slot is being written to
+   * @return reference to slot in slot table
+   */
+  template <typename T>
+  ProductSlot &slotFor(const ProductHandle<T> &handle, bool produced) const {
+    int id{handle.id()};
+    if (id >= 0 and std::size_t(id) < handleSlots_.size() and
+        handleSlots_[id] >= 0)
+      return slots_[handleSlots_[id]];
+    return slots_[resolveHandle(id, handle.name(), handle.passName(),
+                                produced)];
+  }
+
+  /**
+   * Resolve the identifier of a handle to a slot in the slot table
+   *
+   * @throw Exception if the handle is empty
+   *
+   * @param id identifier of the handle
+   * @param collectionName name of product
+   * @param passName pass name of product
+   * @param produced true if the slot is being written to
+   * @return index of slot in slot table
+   */
+  int resolveHandle(int id, const std::string &collectionName,
+                    const std::string &passName, bool produced) const;
+
+  /**
+   * Find the slot with the input identity, creating it if it doesn't exist
+   *
+   * @param collectionName name of product
+   * @param passName pass name of product
+   * @param produced true if the slot is being written to
+   * @return index of slot in slot table
+   */
+  int findSlot(const std::string &collectionName, const std::string &passName,
+               bool produced) const;
+
+  /**
+   * Point a slot at the passenger (and input branch) for a branch
+   *
+   * @param slot ProductSlot to bind
+   * @param branchName name of branch to bind slot to
+   */
+  void bindSlot(ProductSlot &slot, const std::string &branchName) const;
+
+  /**
+   * Mark the slot produced into by the named add as filled, so that
+   * mixing the named and handle forms of add still catch duplicates
+   *
+   * @throw Exception if the slot was already filled by a handle
+   *
+   * @param branchName name of branch being added to
+   */
+  void markSlotFilled(const std::string &branchName);
+
+  /**
+   * Unbind all slots from their passengers
+   *
+   * Called whenever the passengers are deleted.
+   */
+  void resetSlots();
+
+  /**
+   * Settings for output branches whose name matches a regex
+   */
+  struct BranchRule {
+    /// regex to match branch name, unused for the default
+    regex_t exp;
+    /// size of baskets [bytes]
+    int basketSize;
+    /// split level of the branch
+    int splitLevel;
+  };
+
+  /**
+   * Get the settings for an output branch
+   *
+   * @param branchName name of branch
+   * @return last rule matching the branch name or the default settings
+   */
+  const BranchRule &getBranchRule(const std::string &branchName) const;
+
   /**
    * Check if collection should be dropped.
    *
@@ -524,11 +1054,25 @@ class Event {
    */
   class sortPassenger {
    public:
+    /**
+     * Constructor
+     *
+     * Sets how the collections should be ordered
+     */
+    sortPassenger(SortPolicy policy = SortPolicy::Sort) : policy_(policy) {}
+
     /**
      * Sort vectors using the std::sort method.
+     *
+     * Collections assumed to be sorted are only checked with a single pass
+     * and sorted if that check fails. Unordered collections are left alone.
      */
     template <typename T>
     void operator()(std::vector<T> &vec) const {
+      if (policy_ == SortPolicy::Unordered) return;
+      if (policy_ == SortPolicy::AssumeSorted and
+          std::is_sorted(vec.begin(), vec.end()))
+        return;
       std::sort(vec.begin(), vec.end());
     }
 
@@ -542,6 +1086,45 @@ class Event {
                     T &obj) const { /*Nothing on purpose*/
       return;
     }
+
+   private:
+    /** How the collections should be ordered */
+    SortPolicy policy_;
+  };
+
+  /**
+   * @class passengerFootprint
+   * Estimate of the memory held by an event object.
+   *
+   * Only the storage owned directly by the passenger is counted,
+   * memory allocated by the contents themselves is not.
+   */
+  class passengerFootprint {
+   public:
+    /**
+     * Vectors hold their capacity even after being cleared.
+     */
+    template <typename T>
+    std::size_t operator()(const std::vector<T> &vec) const {
+      return sizeof(vec) + vec.capacity() * sizeof(T);
+    }
+
+    /**
+     * Maps hold one node per entry.
+     */
+    template <typename Key, typename Val>
+    std::size_t operator()(const std::map<Key, Val> &m) const {
+      return sizeof(m) +
+             m.size() * sizeof(typename std::map<Key, Val>::value_type);
+    }
+
+    /**
+     * All other objects are just their own size.
+     */
+    template <typename T>
+    std::size_t operator()(const T &obj) const {
+      return sizeof(obj);
+    }
   };
 
   /**
@@ -652,6 +1235,21 @@ class Event {
    */
   mutable std::map<std::string, EventBusPassenger> passengers_;
 
+  /**
+   * Passengers from previous input files kept for their storage.
+   */
+  mutable std::map<std::string, EventBusPassenger> sparePassengers_;
+
+  /**
+   * Largest memory held by the passengers at the end of an event [bytes]
+   */
+  std::size_t busHighWaterMark_{0};
+
+  /**
+   * Total time spent waiting for the input file to be read [s]
+   */
+  mutable double inputStallTime_{0.};
+
   /**
    * List of new branches added.
    */
@@ -672,6 +1270,16 @@ class Event {
    */
   std::vector<regex_t> regexDropCollections_;
 
+  /**
+   * Rules for settings of output branches.
+   */
+  std::vector<BranchRule> branchRules_;
+
+  /**
+   * Settings for output branches that don't match any rule.
+   */
+  BranchRule defaultBranchRule_{regex_t(), 100000, 3};
+
   /**
    * Efficiency cache for empty pass name lookups.
    */
@@ -681,6 +1289,55 @@ class Event {
    * List of all the event products
    */
   std::vector<ProductTag> products_;
+
+  /**
+   * Catalog of indices into the list of products by product name
+   */
+  std::unordered_map<std::string, std::vector<std::size_t> > productsByName_;
+
+  /**
+   * Results of searchProducts for the current list of products
+   *
+   * The key is the three regular expressions joined by a null character.
+   */
+  mutable std::unordered_map<std::string, std::vector<ProductTag> >
+      searchCache_;
+
+  /**
+   * Table of slots that handles are resolved to
+   */
+  mutable std::vector<ProductSlot> slots_;
+
+  /**
+   * Index in the slot table of each handle identifier, negative until
+   * the handle is first used with this event bus
+   */
+  mutable std::vector<int> handleSlots_;
+
+  /**
+   * Map of branch names to the bound slots that are produced into
+   */
+  mutable std::map<std::string, int> producedSlots_;
+
+  /**
+   * True if the bus may be used by several threads during an event
+   */
+  bool concurrentAccess_{false};
+
+  /**
+   * Guard for the bus when concurrent access is on
+   */
+  mutable std::recursive_mutex busMutex_;
+
+  /**
+   * Producers that only run when their products are requested
+   */
+  mutable std::deque<OnDemandProducer> onDemand_;
+
+  /**
+   * Map of product names to the on-demand producer that adds them
+   */
+  std::map<std::string, std::size_t> onDemandProducts_;
 };
 }  // namespace framework
 
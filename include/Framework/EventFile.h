@@ -132,6 +132,21 @@ class EventFile {
    */
   void addDrop(const std::string &rule);
 
+  /**
+   * Declare a product that is consumed by one of the processors.
+   *
+   * If lazy branch loading is enabled, only the input branches that are
+   * consumed or written to the output file are read with each event.
+   * All other input branches are turned off and only loaded if a
+   * processor requests them from the event bus.
+   *
+   * This needs to be called before the first call to nextEvent.
+   *
+   * @param tag ProductTag of the consumed product, an empty pass name
+   * matches any pass
+   */
+  void addConsumed(const ProductTag &tag);
+
   /**
    * Set an Event object containing the event data to work with this file.
    * @param evt The Event object with event data.
@@ -162,6 +177,29 @@ class EventFile {
    */
   int skipToEvent(int offset);
 
+  /**
+   * Set the entry read by the next call to nextEvent.
+   *
+   * An entry past the end of the tree makes the next call return false,
+   * which fills the last event of an output file.
+   *
+   * @param entry entry in the tree to read next
+   */
+  void seekEntry(Long64_t entry) { ientry_ = entry - 1; }
+
+  /// @return the current entry in the tree, negative before the first
+  Long64_t getEntry() const { return ientry_; }
+
+  /**
+   * Save the events filled so far in an output file.
+   *
+   * The baskets are flushed and the tree header is written, so the file
+   * can be recovered up to this point if the job is killed.
+   *
+   * @return number of events in the output tree
+   */
+  Long64_t saveProgress();
+
   /**
    * Close the file, writing the tree to disk if creating an output file.
    *
@@ -191,8 +229,15 @@ class EventFile {
    */
   ldmx::RunHeader &getRunHeader(int runNumber);
 
+  /**
+   * Find the RunHeader for a given run without throwing if it is missing.
+   * @param runNumber The run number.
+   * @return The RunHeader from the input file, null if there isn't one.
+   */
+  ldmx::RunHeader *findRunHeader(int runNumber);
+
   /// @return the name of the ROOT file being managed.
-  const std::string &getFileName() { return fileName_; }
+  const std::string &getFileName() const { return fileName_; }
 
 private:
   /**
@@ -213,6 +258,32 @@ private:
    */
   void importRunHeaders();
 
+  /**
+   * Turn on only the branches of the parent tree that are needed
+   *
+   * Used in place of the reactivation rules when lazy branch loading
+   * is enabled. The needed branches are the EventHeader, the branches
+   * copied to the output tree, and the consumed products.
+   */
+  void activateNeededBranches();
+
+  /**
+   * Apply the cluster (AutoFlush) and AutoSave settings to the output tree
+   *
+   * Called whenever a new output tree is created or cloned, since
+   * cloning copies over the settings of the input tree.
+   */
+  void configureOutputTree();
+
+  /**
+   * Write the layout of the clusters of the output tree
+   *
+   * A tree named 'LDMX_Clusters' is written with one entry per cluster
+   * holding the first and last (inclusive) entry of the cluster, so
+   * downstream jobs can split the file along cluster boundaries.
+   */
+  void writeClusterLayout();
+
 private:
   /// The number of entries in the tree.
   Long64_t entries_{-1};
@@ -261,6 +332,34 @@ private:
    */
   std::vector<std::string> reactivateRules_;
 
+  /**
+   * AutoFlush setting for the output tree
+   *
+   * Positive is the number of entries per cluster, negative is the
+   * number of bytes per cluster, and zero keeps ROOT's default.
+   */
+  Long64_t autoFlush_{0};
+
+  /**
+   * AutoSave setting for the output tree
+   *
+   * Positive is the number of entries between saves, negative is the
+   * number of bytes between saves, and zero keeps ROOT's default.
+   */
+  Long64_t autoSave_{0};
+
+  /// Number of events to fill before tuning the basket sizes, zero is never
+  int basketAutoTuneEvents_{0};
+
+  /// Total memory the baskets of the output tree can use when tuned [bytes]
+  Long64_t basketMemoryBudget_{0};
+
+  /// True if only the needed branches of the input tree should be read
+  bool lazyBranchLoading_{false};
+
+  /// Products declared as consumed by the processors
+  std::vector<ProductTag> consumed_;
+
   /**
    * Map of run numbers to RunHeader objects
    *
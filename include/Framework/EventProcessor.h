@@ -64,6 +64,19 @@ class AbortEventException : public framework::exception::Exception {
  */
 class EventProcessor {
  public:
+  /**
+   * How an EventProcessor can be used when the Process handles
+   * several events at once (numStreams > 1)
+   */
+  enum class Concurrency {
+    /// a single instance that only sees one event at a time (default)
+    One,
+    /// one instance per stream, each made from the same configuration
+    Stream,
+    /// a single instance that is safe to call for several events at once
+    Global
+  };
+
   /**
    * Class constructor.
    * @param name Name for this instance of the class.
@@ -134,6 +147,22 @@ class EventProcessor {
    */
   virtual void onProcessEnd() {}
 
+  /**
+   * Say how this processor can be used when several events are processed
+   * at once.
+   *
+   * The default is Concurrency::One, which is always safe but means this
+   * processor only works on one event at a time. Processors that keep
+   * per-event state in members can return Concurrency::Stream so that each
+   * stream gets its own copy. The extra copies can't get a histogram
+   * directory (getHistoDirectory throws), so processors that book
+   * histograms should stay Concurrency::One. Processors whose
+   * produce/analyze only read their members can return Concurrency::Global.
+   *
+   * @return how this processor can be used concurrently
+   */
+  virtual Concurrency getConcurrency() const { return Concurrency::One; }
+
   /**
    * Access a conditions object for the current event
    */
@@ -142,6 +171,19 @@ class EventProcessor {
     return getConditions().getCondition<T>(condition_name);
   }
 
+  /**
+   * Get a handle to a conditions object
+   *
+   * Get the handle once, in onProcessStart, and use it in every event
+   * instead of getCondition to skip looking the object up by name.
+   *
+   * @see ConditionsHandle
+   */
+  template <class T>
+  ConditionsHandle<T> getConditionsHandle(const std::string &condition_name) {
+    return getConditions().getConditionsHandle<T>(condition_name);
+  }
+
   /**
    * Access/create a directory in the histogram file for this event
    * processor to create histograms and analysis tuples.
@@ -204,7 +246,69 @@ class EventProcessor {
   void createHistograms(
       const std::vector<framework::config::Parameters> &histos);
 
+  /**
+   * Get the products this processor declared that it reads
+   *
+   * @see consumes
+   * @return list of product tags, type names are left empty
+   */
+  const std::vector<ProductTag> &getConsumedProducts() const {
+    return consumedProducts_;
+  }
+
+  /**
+   * Get the products this processor declared that it writes
+   *
+   * @see produces
+   * @return list of product tags, pass names and type names are left empty
+   */
+  const std::vector<ProductTag> &getProducedProducts() const {
+    return producedProducts_;
+  }
+
  protected:
+  /**
+   * Declare that this processor reads the input product
+   *
+   * This should be called in configure or onProcessStart and the
+   * returned handle kept as a member, so that it can be passed to
+   * Event::getObject every event without any string lookups.
+   *
+   * @tparam T type of the product
+   * @param name Name (label, not class name) of the product
+   * @param passName Pass name of the product, empty means any unique pass
+   * @return handle to the product
+   */
+  template <typename T>
+  ProductHandle<T> consumes(const std::string &name,
+                            const std::string &passName = "") {
+    consumedProducts_.emplace_back(name, passName, "");
+    return ProductHandle<T>(name, passName);
+  }
+
+  /**
+   * Declare that this processor writes the input product in the current pass
+   *
+   * This should be called in configure or onProcessStart and the
+   * returned handle kept as a member, so that it can be passed to
+   * Event::add every event without any string lookups.
+   *
+   * @note Only Producers are able to add products to the event bus.
+   *
+   * @tparam T type of the product
+   * @param name Name (label, not class name) of the product
+   * @param sortPolicy How the product should be ordered when it is added,
+   * collections that are filled in order or whose order doesn't matter can
+   * skip the sort
+   * @return handle to the product
+   */
+  template <typename T>
+  ProductHandle<T> produces(const std::string &name,
+                            SortPolicy sortPolicy = SortPolicy::Sort) {
+    producedProducts_.emplace_back(name, "", "");
+    return ProductHandle<T>(name, "", sortPolicy);
+  }
+
   /**
    * Abort the event immediately.
    *
@@ -240,6 +344,12 @@ class EventProcessor {
 
   /** Histogram directory */
   TDirectory *histoDir_{0};
+
+  /** Products this processor declared that it reads */
+  std::vector<ProductTag> consumedProducts_;
+
+  /** Products this processor declared that it writes */
+  std::vector<ProductTag> producedProducts_;
 };
 
 /**
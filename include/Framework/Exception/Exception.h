@@ -5,7 +5,10 @@
 /*   C++ StdLib   */
 /*~~~~~~~~~~~~~~~~*/
 #include <exception>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 namespace framework {
 namespace exception {
@@ -87,10 +90,19 @@ class Exception : public std::exception {
 
   /**
    * Get the full stack trace
+   *
+   * Only the return addresses are saved when the exception is made, since
+   * many exceptions are caught without looking at the trace. They are
+   * turned into function names and source lines the first time the trace
+   * is asked for. That is done once even if several threads ask at the
+   * same time, and copies of the exception share the result.
    */
-  const std::string &stackTrace() const throw() { return stackTrace_; }
+  const std::string &stackTrace() const throw();
 
  private:
+  /**
+   * Save the return addresses of the call stack
+   */
   void buildStackTrace() throw();
 
   /** Exception name. */
@@ -108,8 +120,21 @@ class Exception : public std::exception {
   /** Source line number where the exception occurred. */
   int line_{0};
 
-  /** The stack trace */
-  std::string stackTrace_;
+  /** Return addresses of the call stack */
+  std::vector<void *> frames_;
+
+  /**
+   * Stack trace filled from the return addresses when it is asked for
+   */
+  struct LazyTrace {
+    /// Flag so that the trace is only filled once
+    std::once_flag filled;
+    /// The stack trace, empty until it is asked for
+    std::string trace;
+  };
+
+  /** The stack trace, null if no return addresses were saved */
+  std::shared_ptr<LazyTrace> stackTrace_;
 };
 }  // namespace exception
 }  // namespace framework
@@ -0,0 +1,134 @@
+/**
+ * @file MemoryTracker.h
+ * @brief Class attributing heap allocations to processors and framework phases
+ */
+
+#ifndef FRAMEWORK_MEMORYTRACKER_H_
+#define FRAMEWORK_MEMORYTRACKER_H_
+
+// STL
+#include <string>
+#include <vector>
+
+// LDMX
+#include "Framework/ModuleHook.h"
+
+namespace framework {
+
+/**
+ * @class MemoryTracker
+ * @brief Singleton counting heap allocations by what is running
+ *
+ * Allocations are counted by a separate library replacing the global
+ * operator new and delete (see AllocationCounter), which has to be
+ * preloaded into the job; the framework itself keeps the default
+ * allocation functions. When tracking is enabled, each allocation is
+ * counted against the tag of the calling thread, which is either the
+ * processor being called or the framework phase (reading input, filling
+ * the output tree, clearing the event bus). Allocations made outside of
+ * these are counted as "other".
+ *
+ * The growth of the peak resident set size during each call is also
+ * counted against the tag, which shows which processor makes the memory
+ * of a long job grow. When processors run on several threads at once,
+ * growth is counted against whichever call saw it.
+ *
+ * Only C++ allocations through operator new are counted; memory from
+ * malloc directly (e.g. some of ROOT's buffers) is only seen in the
+ * resident set size.
+ */
+class MemoryTracker : public ModuleHook {
+ public:
+  /**
+   * Framework phases that allocations are counted against
+   */
+  enum Phase { Other = 0, Read, Fill, Clear, NumPhases };
+
+  /// @return The MemoryTracker instance
+  static MemoryTracker &getInstance();
+
+  /**
+   * Start counting allocations
+   *
+   * @throw Exception if the allocation counter library isn't preloaded
+   * @param sequence processors to count allocations of, in order
+   */
+  void enable(const std::vector<EventProcessor *> &sequence);
+
+  /**
+   * Set the tag of this thread to the processor being called
+   *
+   * @param index index of the processor in the sequence
+   * @param module processor being called
+   */
+  void beforeModule(std::size_t index, const EventProcessor &module) final;
+
+  /**
+   * Put the tag of this thread back to what it was before the call
+   *
+   * @param index index of the processor in the sequence
+   * @param module processor that was called
+   */
+  void afterModule(std::size_t index, const EventProcessor &module) final;
+
+  /**
+   * Make a table of the allocations counted against each tag
+   *
+   * @param numEvents number of events processed, for the per-event numbers
+   * @return summary table, one line per tag
+   */
+  std::string summary(long numEvents) const;
+
+  /**
+   * @class Scope
+   * @brief Counts allocations against a framework phase while it exists
+   *
+   * Nothing is done if tracking is off.
+   */
+  class Scope {
+   public:
+    /**
+     * Set the tag of this thread to the input phase
+     *
+     * @param phase Phase being run
+     */
+    Scope(Phase phase);
+
+    /// Put the tag back to what it was
+    ~Scope();
+
+   private:
+    /// Tag before the scope, negative if tracking is off
+    int previous_{-1};
+    /// Peak resident set size when the scope started [kB]
+    long startPeak_{0};
+  };
+
+ private:
+  /// Constructor hidden, use getInstance
+  MemoryTracker() = default;
+
+  /**
+   * Switch the tag of this thread
+   *
+   * @param tag new tag
+   * @param[out] startPeak current peak resident set size [kB]
+   * @return previous tag
+   */
+  static int push(int tag, long &startPeak);
+
+  /**
+   * Put the tag of this thread back
+   *
+   * @param previous tag to put back
+   * @param startPeak peak resident set size when the tag was set [kB]
+   */
+  static void pop(int previous, long startPeak);
+
+  /// Names of the tags, phases first and then processors
+  std::vector<std::string> names_;
+};
+
+}  // namespace framework
+
+#endif  // FRAMEWORK_MEMORYTRACKER_H_
@@ -0,0 +1,51 @@
+/**
+ * @file ModuleHook.h
+ * @brief Interface for instrumenting the processor calls made each event
+ */
+
+#ifndef FRAMEWORK_MODULEHOOK_H_
+#define FRAMEWORK_MODULEHOOK_H_
+
+// STL
+#include <cstddef>
+
+namespace framework {
+
+class EventProcessor;
+
+/**
+ * @class ModuleHook
+ * @brief Code run around every call to produce or analyze
+ *
+ * Hooks are given to the Process before it is run. Each entry in the
+ * table of processor calls is wrapped by the hooks once, so there is
+ * no cost for a processor call when there are no hooks.
+ *
+ * The same hook may be called from several threads at once when events
+ * or processors are run in parallel.
+ */
+class ModuleHook {
+ public:
+  /// Virtual destructor for sub-classes
+  virtual ~ModuleHook() = default;
+
+  /**
+   * Called right before the processor is called
+   *
+   * @param index index of the processor in the sequence
+   * @param module processor being called
+   */
+  virtual void beforeModule(std::size_t index, const EventProcessor &module) = 0;
+
+  /**
+   * Called right after the processor is called, even if it threw
+   *
+   * @param index index of the processor in the sequence
+   * @param module processor that was called
+   */
+  virtual void afterModule(std::size_t index, const EventProcessor &module) = 0;
+};
+
+}  // namespace framework
+
+#endif  // FRAMEWORK_MODULEHOOK_H_
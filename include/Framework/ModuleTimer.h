@@ -0,0 +1,180 @@
+/**
+ * @file ModuleTimer.h
+ * @brief Class timing the calls made to each processor in the sequence
+ */
+
+#ifndef FRAMEWORK_MODULETIMER_H_
+#define FRAMEWORK_MODULETIMER_H_
+
+// STL
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+// LDMX
+#include "Framework/ModuleHook.h"
+
+class TDirectory;
+
+namespace framework {
+
+/**
+ * @class ModuleTimer
+ * @brief Timing of each processor's produce/analyze and callbacks
+ *
+ * Calls to produce/analyze are timed with the steady clock and put
+ * into a histogram with logarithmic bins (eight per factor of two), so
+ * percentiles are known to within a few percent without storing every
+ * call. The counters are atomic, so processors can be timed from
+ * several threads at once without a lock.
+ *
+ * The time of an on-demand producer run by another processor is
+ * included in the time of the processor that requested its product.
+ */
+class ModuleTimer : public ModuleHook {
+ public:
+  /**
+   * Callbacks other than produce/analyze that are timed
+   */
+  enum class Callback { NewRun, FileOpen };
+
+  /**
+   * Class constructor.
+   *
+   * @param sequence processors to time, in order
+   */
+  ModuleTimer(const std::vector<EventProcessor *> &sequence);
+
+  /**
+   * Start timing a call to produce/analyze
+   *
+   * @param index index of the processor in the sequence
+   * @param module processor being called
+   */
+  void beforeModule(std::size_t index, const EventProcessor &module) final;
+
+  /**
+   * Stop timing a call to produce/analyze
+   *
+   * @param index index of the processor in the sequence
+   * @param module processor that was called
+   */
+  void afterModule(std::size_t index, const EventProcessor &module) final;
+
+  /**
+   * Add the time spent in a callback
+   *
+   * Callbacks are only made from the thread running the Process.
+   *
+   * @param index index of the processor in the sequence
+   * @param callback which callback was made
+   * @param seconds time spent in the callback
+   */
+  void addCallbackTime(std::size_t index, Callback callback, double seconds);
+
+  /**
+   * Make a table of the timing of each processor
+   *
+   * @param numEvents number of events processed
+   * @param wallSeconds time it took to process them
+   * @return summary table, one line per processor
+   */
+  std::string summary(long numEvents, double wallSeconds) const;
+
+  /**
+   * Write the timing of each processor to a JSON file
+   *
+   * @param fileName name of file to write
+   */
+  void writeJson(const std::string &fileName) const;
+
+  /**
+   * Write the timing of each processor as a TTree
+   *
+   * @param dir directory to write the tree into
+   */
+  void writeTree(TDirectory *dir) const;
+
+ private:
+  /// Number of bins per factor of two in the histogram of call times
+  static constexpr int BINS_PER_OCTAVE{8};
+
+  /// Number of bins in the histogram of call times, covers any 64-bit time
+  static constexpr int NUM_BINS{64 * BINS_PER_OCTAVE};
+
+  /**
+   * Timing of one processor
+   */
+  struct Timing {
+    /// Number of calls to produce/analyze
+    std::atomic<long> calls{0};
+    /// Total time in produce/analyze [ns]
+    std::atomic<long> total{0};
+    /// Longest call to produce/analyze [ns]
+    std::atomic<long> max{0};
+    /// Histogram of the time of each call to produce/analyze
+    std::array<std::atomic<long>, NUM_BINS> bins{};
+    /// Number of calls to onNewRun
+    long newRunCalls{0};
+    /// Total time in onNewRun [s]
+    double newRunTime{0.};
+    /// Number of calls to onFileOpen
+    long fileOpenCalls{0};
+    /// Total time in onFileOpen [s]
+    double fileOpenTime{0.};
+  };
+
+  /**
+   * Summary numbers for one processor
+   */
+  struct Summary {
+    /// Number of calls to produce/analyze
+    long calls;
+    /// Total time in produce/analyze [s]
+    double total;
+    /// Mean time of a call [s]
+    double mean;
+    /// Median time of a call [s]
+    double p50;
+    /// 99th percentile time of a call [s]
+    double p99;
+    /// Longest call [s]
+    double max;
+  };
+
+  /**
+   * Get the bin of the histogram that a call time goes in
+   *
+   * @param ns time of call [ns]
+   * @return bin index
+   */
+  static int bin(long ns);
+
+  /**
+   * Get the time at the center of a bin
+   *
+   * @param bin index of bin
+   * @return time [ns]
+   */
+  static double binCenter(int bin);
+
+  /**
+   * Calculate the summary numbers for a processor
+   *
+   * @param timing Timing of the processor
+   * @return summary numbers
+   */
+  static Summary summarize(const Timing &timing);
+
+  /// Names of the processors
+  std::vector<std::string> names_;
+
+  /// Timing of each processor, in the same order as the sequence
+  std::unique_ptr<Timing[]> timings_;
+};
+
+}  // namespace framework
+
+#endif  // FRAMEWORK_MODULETIMER_H_
@@ -117,6 +117,9 @@ class NtupleManager {
   /// Reset all of the variables to their limits.
   void clear();
 
+  /// @return true if no ntuples have been created
+  bool empty() const { return trees_.empty(); }
+
   /// Hide Copy Constructor
   NtupleManager(const NtupleManager&) = delete;
 
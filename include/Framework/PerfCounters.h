@@ -0,0 +1,100 @@
+/**
+ * @file PerfCounters.h
+ * @brief Class reading hardware performance counters around processor calls
+ */
+
+#ifndef FRAMEWORK_PERFCOUNTERS_H_
+#define FRAMEWORK_PERFCOUNTERS_H_
+
+// STL
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+// LDMX
+#include "Framework/ModuleHook.h"
+
+namespace framework {
+
+/**
+ * @class PerfCounters
+ * @brief Hardware counters of each processor's produce/analyze calls
+ *
+ * The Linux perf_event_open interface is used to count the CPU cycles,
+ * instructions, cache misses and branch misses of the thread making
+ * each call. The counters are opened for each thread the first time it
+ * calls a processor. Only user-space events are counted, which is what
+ * is allowed for unprivileged users by default.
+ *
+ * If the kernel has to share the hardware registers with other counters,
+ * it multiplexes them and the counts of a call are scaled up by the time
+ * the counters were enabled over the time they were running. The summary
+ * lists how many calls of each processor were scaled.
+ *
+ * If the counters can't be opened (the kernel doesn't allow it, the
+ * hardware doesn't have them, or this isn't Linux), the calls are not
+ * counted and the summary says why.
+ */
+class PerfCounters : public ModuleHook {
+ public:
+  /// Number of counters read
+  static constexpr int NUM_COUNTERS{4};
+
+  /**
+   * Class constructor.
+   *
+   * @param sequence processors to count, in order
+   */
+  PerfCounters(const std::vector<EventProcessor *> &sequence);
+
+  /**
+   * Read the counters before a call to produce/analyze
+   *
+   * @param index index of the processor in the sequence
+   * @param module processor being called
+   */
+  void beforeModule(std::size_t index, const EventProcessor &module) final;
+
+  /**
+   * Read the counters after a call and add the difference to the processor
+   *
+   * @param index index of the processor in the sequence
+   * @param module processor that was called
+   */
+  void afterModule(std::size_t index, const EventProcessor &module) final;
+
+  /**
+   * Make a table of the counts for each processor
+   *
+   * @return summary table, one line per processor
+   */
+  std::string summary() const;
+
+ private:
+  /**
+   * Counts for one processor
+   */
+  struct Counts {
+    /// Number of calls counted
+    std::atomic<long> calls{0};
+    /// Number of calls whose counts were scaled because of multiplexing
+    std::atomic<long> multiplexed{0};
+    /// Sum of each counter over the calls
+    std::array<std::atomic<unsigned long>, NUM_COUNTERS> sums{};
+  };
+
+  /// Names of the processors
+  std::vector<std::string> names_;
+
+  /// Counts of each processor, in the same order as the sequence
+  std::unique_ptr<Counts[]> counts_;
+
+  /// Set if any thread couldn't open the counters
+  std::atomic<int> openError_{0};
+};
+
+}  // namespace framework
+
+#endif  // FRAMEWORK_PERFCOUNTERS_H_
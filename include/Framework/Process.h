@@ -8,15 +8,25 @@
 #define LDMXSW_FRAMEWORK_PROCESS_H_
 
 // LDMX
+#include "Framework/Checkpoint.h"
 #include "Framework/Conditions.h"
 #include "Framework/Configure/Parameters.h"
 #include "Framework/Exception/Exception.h"
+#include "Framework/ModuleHook.h"
+#include "Framework/ModuleTimer.h"
+#include "Framework/PerfCounters.h"
 #include "Framework/RunHeader.h"
+#include "Framework/SequenceGraph.h"
+#include "Framework/SlowEvents.h"
 #include "Framework/StorageControl.h"
+#include "Framework/ThreadPool.h"
 
 // STL
+#include <csignal>
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 class TFile;
@@ -64,7 +74,7 @@ class Process {
   /**
    * Get the pointer to the current event header, if defined
    */
-  const ldmx::EventHeader *getEventHeader() const { return eventHeader_; }
+  const ldmx::EventHeader *getEventHeader() const;
 
   /**
    * Get the pointer to the current run header, if defined
@@ -89,11 +99,46 @@ class Process {
 
   /**
    * Request that the processing finish with this event
+   *
+   * This only sets a flag, so it can be called from a signal handler.
+   * The event being processed is finished, a checkpoint is written if
+   * they are on, and the output files are closed as usual.
+   */
+  void requestFinish() { finishRequested_ = 1; }
+
+  /**
+   * Continue the job from its last checkpoint instead of from the start
+   *
+   * Must be called before run. The events after the checkpoint are
+   * written to new output and histogram files, named after the event
+   * the job continues from, so the files from the first part of the
+   * job are kept.
+   */
+  void resume() { resume_ = true; }
+
+  /**
+   * Check if the job is continuing from a checkpoint
+   * @return true if resume was called
+   */
+  bool isResuming() const { return resume_; }
+
+  /**
+   * Check if the job writes checkpoints
+   * @return true if checkpoints are taken every few events
+   */
+  bool isCheckpointing() const { return checkpointEvents_ > 0; }
+
+  /**
+   * Check if the job reads events from input files
+   * @return true if there are input files, false when producing events
    */
-  void requestFinish() { eventLimit_ = 0; }
+  bool hasInputFiles() const { return not inputFiles_.empty(); }
 
   /**
    * Construct a TDirectory* for the given module
+   *
+   * @throw Exception if the directory was already made, e.g. by a copy
+   * of the processor made for another stream
    */
   TDirectory *makeHistoDirectory(const std::string &dirName);
 
@@ -105,7 +150,25 @@ class Process {
   /**
    * Access the storage control unit for this process
    */
-  StorageControl &getStorageController() { return m_storageController; }
+  StorageControl &getStorageController();
+
+  /**
+   * Get the pool of worker threads owned by this process
+   *
+   * The pool has the same number of threads as ROOT's implicit
+   * multi-threading is given, so tasks can be spread out across it
+   * without asking for more threads than the job was configured for.
+   */
+  ThreadPool &getThreadPool() { return *threadPool_; }
+
+  /**
+   * Add a hook that is run around every call to produce or analyze
+   *
+   * Hooks have to be added before the process is run.
+   */
+  void addModuleHook(std::shared_ptr<ModuleHook> hook) {
+    moduleHooks_.push_back(hook);
+  }
 
   /**
    * Set the pointer to the current event header, used only for tests
@@ -125,6 +188,148 @@ class Process {
   static Process getDummy() { return std::move(Process()); }
 
  private:
+  /**
+   * One event in flight when several events are processed at once
+   */
+  struct Stream;
+
+  /**
+   * Entry in the table of processor calls made for each event
+   */
+  struct ModuleCall {
+    /// Processor being called
+    EventProcessor *module;
+    /// Calls produce or analyze on the processor, wrapped by any hooks
+    std::function<void(Event &)> run;
+  };
+
+  /**
+   * Make the table entry for a processor
+   *
+   * The processor is classified as a Producer or Analyzer here, so there
+   * is no casting when the table is run for each event.
+   *
+   * @param module processor to call
+   * @param index index of the processor in the sequence
+   * @param lock lock to hold if the processor only sees one event at a
+   * time, null if only one event is processed at once
+   * @return entry for the table of processor calls
+   */
+  ModuleCall makeModuleCall(EventProcessor *module, std::size_t index,
+                            std::mutex *lock = nullptr) const;
+
+  /**
+   * Process all of the events in production mode with several streams
+   *
+   * Each stream has its own event bus and storage control. Events are
+   * handed to free streams and run on the thread pool, then moved onto
+   * the input event bus and written in order, so the output file has
+   * the same event order as a single-stream run.
+   *
+   * @param writer Event that is attached to the output file
+   * @param outFile output file to write events to
+   * @param eventsProcessed number of events processed before, non-zero
+   * when resuming
+   * @return number of events processed
+   */
+  int processStreams(Event &writer, EventFile &outFile, int eventsProcessed);
+
+  /**
+   * Run the processors on one event
+   *
+   * If the sequence can run in parallel, independent processors are run
+   * at the same time on the thread pool. Otherwise they are run in order.
+   *
+   * @param event Event bus to run the processors on
+   * @param calls table of processor calls, in the same order as sequence_
+   * @return true if a processor aborted the event
+   */
+  bool processEvent(Event &event, const std::vector<ModuleCall> &calls);
+
+  /**
+   * Find the processors that still have to run once the filters have
+   * decided that the event will be dropped
+   *
+   * Analyzers always run. Producers only run if a later processor that
+   * runs declared that it reads one of their products, or a later
+   * processor that runs didn't declare what it reads.
+   *
+   * Processors matched by a skim rule can vote on the event, so they are
+   * treated as filters even if they weren't marked as one. If one of them
+   * is an on-demand producer, nothing is skipped.
+   */
+  void configureFilters();
+
+  /**
+   * Make a callback on each processor in the sequence
+   *
+   * The callbacks are timed if module timing is on.
+   *
+   * @param callback which callback is being made
+   * @param call function making the callback on a processor
+   */
+  void callEachModule(ModuleTimer::Callback callback,
+                      const std::function<void(EventProcessor *)> &call);
+
+  /**
+   * Register the on-demand producers with an event bus
+   *
+   * @param event Event bus the producers are requested from
+   * @param calls table of processor calls run on this bus
+   */
+  void setupOnDemand(Event &event, const std::vector<ModuleCall> &calls);
+
+  /**
+   * Tell the producers, conditions and processors about a new run
+   *
+   * When resuming, the master seed from the checkpoint is put into the
+   * run header first so the random number seed service uses it.
+   *
+   * @param runHeader RunHeader of the new run
+   */
+  void newRun(ldmx::RunHeader &runHeader);
+
+  /**
+   * Save the output written so far and then write a checkpoint
+   *
+   * Called between events, once the last processed event has been
+   * filled into the output tree.
+   *
+   * @param eventsProcessed number of events processed so far
+   * @param input input file being read, null if there is none
+   * @param output output file being written, null if there is none
+   */
+  void saveCheckpoint(int eventsProcessed, EventFile *input,
+                      EventFile *output);
+
+  /**
+   * Check if a checkpoint should be taken
+   *
+   * @param eventsProcessed number of events processed so far
+   * @return true if checkpoints are on and one is due
+   */
+  bool checkpointDue(int eventsProcessed) const {
+    return checkpointEvents_ > 0 and
+           eventsProcessed % checkpointEvents_ == 0 and
+           eventsProcessed != checkpoint_.eventsProcessed;
+  }
+
+  /**
+   * Find where an event came from, for the list of slow events
+   *
+   * @param event Event bus holding the event
+   * @return run and event numbers, and input file and entry if there is one
+   */
+  SlowEvents::Source eventSource(Event &event) const;
+
+  /**
+   * Copy the slowest events from the input files into the replay file
+   *
+   * The events are copied as they were read, before this pass, so the
+   * job can be rerun on just those events.
+   */
+  void writeReplayFile();
+
   /**
    * Private dummy constructor
    * We hide it here because it shouldn't be used anywhere else.
@@ -163,6 +368,54 @@ class Process {
   /** Ordered list of EventProcessors to execute. */
   std::vector<EventProcessor *> sequence_;
 
+  /** Table of calls to the processors in the sequence */
+  std::vector<ModuleCall> calls_;
+
+  /** Hooks run around every processor call */
+  std::vector<std::shared_ptr<ModuleHook>> moduleHooks_;
+
+  /** Timing of each processor, null if module timing is off */
+  std::shared_ptr<ModuleTimer> moduleTimer_;
+
+  /** Name of JSON file to write module timing to, empty for none */
+  std::string moduleTimingJson_;
+
+  /** Write module timing as a TTree in the histogram file */
+  bool moduleTimingTree_{false};
+
+  /** Hardware counters of each processor, null if they are off */
+  std::shared_ptr<PerfCounters> perfCounters_;
+
+  /** Slowest events overall and of each processor, null if off */
+  std::shared_ptr<SlowEvents> slowEvents_;
+
+  /** Name of file to copy the slowest input events to, empty for none */
+  std::string replayFile_;
+
+  /** Input file events are being read from, null if there is none */
+  EventFile *currentInput_{nullptr};
+
+  /** Number of events between checkpoints, zero if they are off */
+  int checkpointEvents_{0};
+
+  /** Name of the file checkpoints are written to and resumed from */
+  std::string checkpointFile_;
+
+  /** Progress of this job, written at each checkpoint */
+  Checkpoint checkpoint_;
+
+  /** Continue from the last checkpoint */
+  bool resume_{false};
+
+  /** Set when finishing early was requested, e.g. by Ctrl-c */
+  volatile std::sig_atomic_t finishRequested_{0};
+
+  /** Count heap allocations of each processor and framework phase */
+  bool memoryTracking_{false};
+
+  /** Name of file to write the timeline of processing to, empty for none */
+  std::string traceFile_;
+
   /** Set of ConditionsProviders */
   Conditions conditions_;
 
@@ -182,6 +435,42 @@ class Process {
    */
   int compressionSetting_;
 
+  /** Parameters used to configure each processor in the sequence */
+  std::vector<framework::config::Parameters> sequenceParameters_;
+
+  /** Number of events processed at once, more than one only in production */
+  int numStreams_{1};
+
+  /** Stream that the current thread is processing an event for */
+  static thread_local Stream *currentStream_;
+
+  /** Number of threads for ROOT's implicit multi-threading and our pool */
+  int numThreads_{1};
+
+  /** Pool of worker threads for framework tasks */
+  std::shared_ptr<ThreadPool> threadPool_{std::make_shared<ThreadPool>(1)};
+
+  /** Run processors that don't depend on each other at the same time */
+  bool parallelSequence_{false};
+
+  /** Dependencies between processors, null if they are run in order */
+  std::shared_ptr<SequenceGraph> sequenceGraph_;
+
+  /** True for each producer in the sequence that only runs on demand */
+  std::vector<bool> onDemand_;
+
+  /** Event bus attached to the output file, used to see what is kept */
+  const Event *outputEvent_{nullptr};
+
+  /** True for each processor in the sequence that votes on the event */
+  std::vector<bool> filters_;
+
+  /** True for each processor that still runs once the event is dropped */
+  std::vector<bool> neededWhenDropped_;
+
+  /** Number of filters in the scheduled sequence */
+  int numFilters_{0};
+
   /** Set of drop/keep rules. */
   std::vector<std::string> dropKeepRules_;
 
@@ -0,0 +1,122 @@
+/**
+ * @file ProductHandle.h
+ * @brief Class defining a typed token for a product on the event bus
+ */
+
+#ifndef FRAMEWORK_PRODUCTHANDLE_H_
+#define FRAMEWORK_PRODUCTHANDLE_H_
+
+// STL
+#include <string>
+
+namespace framework {
+
+class Event;
+
+/**
+ * Get a new identifier for a ProductHandle
+ *
+ * @return identifier that no other declared handle has
+ */
+int makeProductHandleId();
+
+/**
+ * How a collection should be ordered when it is added to the event bus
+ *
+ * Vectors on the event bus are sorted by their content's operator <
+ * by default, so that the order of the output does not depend on the
+ * order a producer happened to fill it in.
+ */
+enum class SortPolicy {
+  /// sort the collection with std::sort (the default)
+  Sort,
+  /// the producer filled the collection in order, check with std::is_sorted
+  /// and only sort it if that check fails
+  AssumeSorted,
+  /// the order of the collection doesn't matter, leave it as it is
+  Unordered
+};
+
+/**
+ * @class ProductHandle
+ * @brief Typed token for a product that an EventProcessor reads or writes
+ *
+ * Handles are declared once by an EventProcessor (usually with
+ * EventProcessor::consumes or EventProcessor::produces in configure or
+ * onProcessStart) and then passed to Event::getObject or Event::add
+ * every event. Each declared handle gets its own identifier. The first
+ * time a handle is used with an Event, that Event resolves the identifier
+ * to an integer slot and keeps it. After that, accessing the product is
+ * an index into the slot table instead of building a branch name and
+ * looking it up by string.
+ *
+ * The handle itself is never changed by an Event, so one handle can be
+ * used with the event buses of several streams at once. Copies of a
+ * handle share its identifier; declare handles once rather than making
+ * new ones every event.
+ *
+ * @tparam T type of the product (e.g. std::vector<ldmx::CalorimeterHit>)
+ */
+template <typename T>
+class ProductHandle {
+ public:
+  /**
+   * Default constructor
+   *
+   * An empty handle has no name and cannot be used to access a product.
+   */
+  ProductHandle() = default;
+
+  /**
+   * Class constructor.
+   *
+   * @param name Name (label, not class name) of the product
+   * @param passName Pass name of the product, empty means any unique pass
+   * when reading and the current pass when writing
+   * @param sortPolicy How to order the product when it is added
+   */
+  ProductHandle(const std::string &name, const std::string &passName = "",
+                SortPolicy sortPolicy = SortPolicy::Sort)
+      : name_{name},
+        passName_{passName},
+        sortPolicy_{sortPolicy},
+        id_{makeProductHandleId()} {}
+
+  /**
+   * Get the product name
+   */
+  const std::string &name() const { return name_; }
+
+  /**
+   * Get the product pass name
+   */
+  const std::string &passName() const { return passName_; }
+
+  /**
+   * Get how the product is ordered when it is added
+   */
+  SortPolicy sortPolicy() const { return sortPolicy_; }
+
+  /**
+   * Get the identifier the event bus keeps the slot of this handle under,
+   * negative for an empty handle
+   */
+  int id() const { return id_; }
+
+ private:
+  /// Name given to the product
+  std::string name_;
+
+  /// Pass name given to the product
+  std::string passName_;
+
+  /// How the product is ordered when it is added
+  SortPolicy sortPolicy_{SortPolicy::Sort};
+
+  /// Identifier of this handle
+  int id_{-1};
+};
+
+}  // namespace framework
+
+#endif  // FRAMEWORK_PRODUCTHANDLE_H_
@@ -7,6 +7,11 @@
 #ifndef FRAMEWORK_RANDOMNUMBERSEEDSERVICE_H_
 #define FRAMEWORK_RANDOMNUMBERSEEDSERVICE_H_
 
+/*~~~~~~~~~~~~~~~~*/
+/*   C++ StdLib   */
+/*~~~~~~~~~~~~~~~~*/
+#include <array>
+
 /*~~~~~~~~~~~~~~~*/
 /*   Framework   */
 /*~~~~~~~~~~~~~~~*/
@@ -29,6 +34,13 @@ namespace framework {
  * Individual seeds are then constructed using the master seed and a simple hash
  * based on the name of the seed. Seeds can also be specified in the python
  * file, in which case no autoseeding will be performed.
+ *
+ * Seeds from getSeed are the same for every event, so a generator seeded
+ * once gives results that depend on the order events are processed in.
+ * Per-event seeds from getEventSeed are instead derived from the master
+ * seed, the run and event numbers and the name with the counter-based
+ * Philox4x32-10 generator. Any event can be regenerated on its own, and
+ * jobs split into streams or shards give the same events as a serial job.
  */
 class RandomNumberSeedService : public ConditionsObject,
                                 public ConditionsObjectProvider {
@@ -58,6 +70,9 @@ class RandomNumberSeedService : public ConditionsObject,
    * If we are using the run number as the master seed,
    * then we get the run number and set the master seed to it.
    *
+   * If the Process is resuming from a checkpoint and the RunHeader
+   * already has a master seed for this pass, that seed is used instead.
+   *
    * No matter what, we put the master seed into the RunHeader
    * to be persisted into the output file.
    *
@@ -73,11 +88,85 @@ class RandomNumberSeedService : public ConditionsObject,
    * it generates the seed for that name by combining
    * the master seed with a hash of the name.
    *
+   * A generator seeded once with this seed would start over when a job
+   * is resumed from a checkpoint and repeat the events it made before.
+   * Jobs that produce events and may be resumed should seed generators
+   * for each event with getEventSeed instead.
+   *
+   * @throws Exception if a job without input files is being resumed
+   *
    * @param[in] name Name of seed
    * @return seed derived from master seed using the input name
    */
   uint64_t getSeed(const std::string& name) const;
 
+  /**
+   * @class SeedHandle
+   * Hash of the name of a per-event seed
+   *
+   * Get it once with getSeedHandle, so the name doesn't need to be hashed
+   * or looked up for each event.
+   */
+  class SeedHandle {
+   public:
+    /// @return 64-bit hash of the name of the seed
+    uint64_t hash() const { return hash_; }
+
+   private:
+    friend class RandomNumberSeedService;
+    /// 64-bit hash of the name of the seed
+    uint64_t hash_{0};
+  };
+
+  /**
+   * Get the handle for per-event seeds with a given name
+   *
+   * @param[in] name Name of seed
+   * @return handle to give to getEventSeed
+   */
+  SeedHandle getSeedHandle(const std::string& name) const;
+
+  /**
+   * Get the seed of a given name for one event
+   *
+   * The seed is the Philox4x32-10 output of the counter
+   * (event number, run number, name hash) under the master seed as key,
+   * so it doesn't depend on which events were processed before or on
+   * which thread. Nothing is cached, so this can be called from any stream.
+   *
+   * @param[in] handle Handle of the seed name from getSeedHandle
+   * @param[in] header EventHeader of the event to seed
+   * @return seed for this name in this event
+   */
+  uint64_t getEventSeed(const SeedHandle& handle,
+                        const ldmx::EventHeader& header) const;
+
+  /**
+   * Get the seed of a given name for one event
+   *
+   * @see getEventSeed(const SeedHandle&, const ldmx::EventHeader&)
+   * @param[in] name Name of seed
+   * @param[in] header EventHeader of the event to seed
+   * @return seed for this name in this event
+   */
+  uint64_t getEventSeed(const std::string& name,
+                        const ldmx::EventHeader& header) const {
+    return getEventSeed(getSeedHandle(name), header);
+  }
+
+  /**
+   * The Philox4x32-10 counter-based generator
+   *
+   * Salmon et al., "Parallel random numbers: as easy as 1, 2, 3" (SC11).
+   * Each counter and key gives four independent 32-bit random numbers.
+   *
+   * @param[in] counter counter to encrypt
+   * @param[in] key key to encrypt it with
+   * @return random output for this counter and key
+   */
+  static std::array<uint32_t, 4> philox(std::array<uint32_t, 4> counter,
+                                        std::array<uint32_t, 2> key);
+
   /**
    * Get a list of all the known seeds
    *
@@ -0,0 +1,88 @@
+/**
+ * @file SequenceGraph.h
+ * @brief Class running the processors in a sequence by their data dependencies
+ */
+
+#ifndef FRAMEWORK_SEQUENCEGRAPH_H_
+#define FRAMEWORK_SEQUENCEGRAPH_H_
+
+// STL
+#include <functional>
+#include <string>
+#include <vector>
+
+// LDMX
+#include "Framework/ThreadPool.h"
+
+namespace framework {
+
+class EventProcessor;
+
+/**
+ * @class SequenceGraph
+ * @brief Dependency graph between the processors of a sequence
+ *
+ * The graph is built once from the products each processor declared
+ * with EventProcessor::consumes and EventProcessor::produces. A
+ * processor depends on an earlier one if it consumes a product the
+ * earlier one produces in this pass, or if both produce the same
+ * product. A processor that declared nothing could read or write
+ * anything, so it depends on every earlier processor and every later
+ * processor depends on it.
+ *
+ * For each event, processors are run as soon as everything they depend
+ * on has finished, so independent processors run at the same time on
+ * the thread pool. The thread running the event also runs processors,
+ * and it only waits when every processor that is ready is already
+ * running, so the pool may be used by several events at once.
+ *
+ * Processors that declare their products must declare everything they
+ * read from the event bus, otherwise they may run before the producer
+ * of a product they read.
+ */
+class SequenceGraph {
+ public:
+  /**
+   * Build the graph for a sequence
+   *
+   * @param sequence processors in the order they were configured
+   * @param passName name of the current pass
+   */
+  SequenceGraph(const std::vector<EventProcessor *> &sequence,
+                const std::string &passName);
+
+  /**
+   * Check if any processors in the sequence can run at the same time
+   *
+   * @return true if the sequence isn't a single chain
+   */
+  bool isParallel() const { return parallel_; }
+
+  /**
+   * Run the processors for one event
+   *
+   * If a processor aborts the event, the processors that haven't started
+   * are skipped. Any other exception is rethrown once the processors that
+   * are already running have finished.
+   *
+   * @param pool ThreadPool to run independent processors on
+   * @param runModule callable that runs the processor at the input index
+   * @return true if the event was aborted
+   */
+  bool run(ThreadPool &pool,
+           const std::function<void(std::size_t)> &runModule) const;
+
+ private:
+  /// Indices of the processors depending on each processor
+  std::vector<std::vector<std::size_t>> successors_;
+
+  /// Number of processors each processor depends on
+  std::vector<int> numDependencies_;
+
+  /// True if any processors can run at the same time
+  bool parallel_{false};
+};
+
+}  // namespace framework
+
+#endif  // FRAMEWORK_SEQUENCEGRAPH_H_
@@ -0,0 +1,163 @@
+/**
+ * @file SlowEvents.h
+ * @brief Class keeping the slowest events of a job
+ */
+
+#ifndef FRAMEWORK_SLOWEVENTS_H_
+#define FRAMEWORK_SLOWEVENTS_H_
+
+// STL
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace framework {
+
+class EventProcessor;
+
+/**
+ * @class SlowEvents
+ * @brief The slowest events overall and in each processor
+ *
+ * A few pathological events can take most of the time of a job. The
+ * slowest events are kept with their run and event numbers and, when
+ * they were read from an input file, the name of the file and the entry
+ * in it, so they can be found and written to a small file to reproduce
+ * them.
+ *
+ * Times are added from any thread. Each list only takes its lock for
+ * times that are slower than the fastest event it is keeping.
+ */
+class SlowEvents {
+ public:
+  /**
+   * Where an event came from
+   */
+  struct Source {
+    /// Run number
+    int run{0};
+    /// Event number
+    int event{0};
+    /// Name of input file, empty if the event was produced by this job
+    std::string file;
+    /// Entry in the input file, negative if there is no input file
+    long entry{-1};
+  };
+
+  /**
+   * A slow event
+   */
+  struct Record {
+    /// Time spent on the event [s]
+    double seconds;
+    /// Where the event came from
+    Source source;
+  };
+
+  /**
+   * Class constructor.
+   *
+   * @param keep number of events to keep in each list
+   * @param sequence processors to keep the slowest events of, in order
+   */
+  SlowEvents(std::size_t keep, const std::vector<EventProcessor *> &sequence);
+
+  /**
+   * Check if a time is slow enough to be kept
+   *
+   * Used so the source only needs to be made for slow events.
+   *
+   * @param index index of the processor, or the size of the sequence
+   * for the time of the whole event
+   * @param seconds time spent
+   * @return true if the time would be kept
+   */
+  bool isSlow(std::size_t index, double seconds) const {
+    return seconds > lists_[index].threshold.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Add the time of a processor call
+   *
+   * @param index index of the processor in the sequence
+   * @param seconds time spent in the call
+   * @param source where the event came from
+   */
+  void addModuleTime(std::size_t index, double seconds, const Source &source) {
+    add(index, seconds, source);
+  }
+
+  /**
+   * Add the time of a whole event
+   *
+   * @param seconds time spent processing the event
+   * @param source where the event came from
+   */
+  void addEventTime(double seconds, const Source &source) {
+    add(names_.size(), seconds, source);
+  }
+
+  /// @return index to give isSlow for the time of the whole event
+  std::size_t eventIndex() const { return names_.size(); }
+
+  /**
+   * Get the slowest events of a list, slowest first
+   *
+   * @param index index of the processor, or eventIndex for whole events
+   * @return slowest events
+   */
+  std::vector<Record> slowest(std::size_t index) const;
+
+  /**
+   * Get the input entries of every event kept in any list
+   *
+   * @return entries in each input file, in order
+   */
+  std::map<std::string, std::set<long>> inputEntries() const;
+
+  /**
+   * Make a table of the slowest events
+   *
+   * @return the slowest events overall and the slowest few of each processor
+   */
+  std::string summary() const;
+
+ private:
+  /**
+   * Slowest events of one processor or of whole events
+   */
+  struct List {
+    /// Kept events, a heap with the fastest on top
+    std::vector<Record> records;
+    /// Time an event needs to be kept, zero until the list is full [s]
+    std::atomic<double> threshold{0.};
+    /// Guard for the records
+    mutable std::mutex mutex;
+  };
+
+  /**
+   * Add a time to a list if it is one of the slowest
+   *
+   * @param index index of the list
+   * @param seconds time spent
+   * @param source where the event came from
+   */
+  void add(std::size_t index, double seconds, const Source &source);
+
+  /// Number of events kept in each list
+  std::size_t keep_;
+
+  /// Names of the processors
+  std::vector<std::string> names_;
+
+  /// List of each processor and then of whole events
+  std::unique_ptr<List[]> lists_;
+};
+
+}  // namespace framework
+
+#endif  // FRAMEWORK_SLOWEVENTS_H_
@@ -65,6 +65,13 @@ class StorageControl {
    */
   bool keepEvent() const;
 
+  /**
+   * Check if hints from a processor can be counted by a rule
+   * @param processor_name Name of the event processor
+   * @return true if the processor name matches the pattern of any rule
+   */
+  bool canVote(const std::string& processor_name) const;
+
  private:
   /**
    * Default state for storage control
@@ -0,0 +1,120 @@
+/**
+ * @file ThreadPool.h
+ * @brief Class providing a pool of worker threads for framework tasks
+ */
+
+#ifndef FRAMEWORK_THREADPOOL_H_
+#define FRAMEWORK_THREADPOOL_H_
+
+// STL
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace framework {
+
+/**
+ * @class ThreadPool
+ * @brief Fixed-size pool of worker threads owned by the Process
+ *
+ * Tasks are submitted as callables and run on the first free worker.
+ * The returned future can be used to wait for the task and retrieve
+ * its result (or rethrow any exception it threw).
+ *
+ * A pool with one thread or less has no workers and runs each task
+ * immediately on the submitting thread, so the same code works in a
+ * single-threaded process.
+ */
+class ThreadPool {
+ public:
+  /**
+   * Class constructor.
+   *
+   * Starts the worker threads.
+   *
+   * @param numThreads Number of threads to run tasks on
+   */
+  ThreadPool(int numThreads);
+
+  /**
+   * Class destructor.
+   *
+   * Finishes the tasks that are already queued and joins the workers.
+   */
+  ~ThreadPool();
+
+  /// Not copyable, the workers hold a reference to this pool
+  ThreadPool(const ThreadPool &) = delete;
+  /// Not assignable, the workers hold a reference to this pool
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  /**
+   * Get the number of threads tasks can run on
+   *
+   * @return number of threads, at least one
+   */
+  int getNumThreads() const { return numThreads_; }
+
+  /**
+   * Submit a task to the pool
+   *
+   * @tparam F type of callable with no arguments
+   * @param task callable to run
+   * @return future holding the result of the task
+   */
+  template <typename F>
+  std::future<std::invoke_result_t<F>> submit(F &&task) {
+    using Result = std::invoke_result_t<F>;
+    // std::function needs to be copyable, the packaged task is not
+    auto packaged = std::make_shared<std::packaged_task<Result()>>(
+        std::forward<F>(task));
+    std::future<Result> result{packaged->get_future()};
+    if (workers_.empty()) {
+      (*packaged)();
+    } else {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.emplace_back([packaged]() { (*packaged)(); });
+      }
+      available_.notify_one();
+    }
+    return result;
+  }
+
+ private:
+  /**
+   * Loop run by each worker thread
+   *
+   * Waits for a task, runs it, and repeats until the pool is stopped
+   * and there are no tasks left.
+   */
+  void work();
+
+  /// Number of threads tasks can run on
+  int numThreads_;
+
+  /// Worker threads
+  std::vector<std::thread> workers_;
+
+  /// Queue of tasks waiting for a worker
+  std::deque<std::function<void()>> tasks_;
+
+  /// Guard for the queue of tasks and the stopping flag
+  std::mutex mutex_;
+
+  /// Signal to the workers that a task is available or the pool is stopping
+  std::condition_variable available_;
+
+  /// True if the workers should exit once the queue is empty
+  bool stopping_{false};
+};
+
+}  // namespace framework
+
+#endif  // FRAMEWORK_THREADPOOL_H_
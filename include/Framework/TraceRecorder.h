@@ -0,0 +1,186 @@
+/**
+ * @file TraceRecorder.h
+ * @brief Class recording a timeline of the processing in Chrome trace format
+ */
+
+#ifndef FRAMEWORK_TRACERECORDER_H_
+#define FRAMEWORK_TRACERECORDER_H_
+
+// STL
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace framework {
+
+/**
+ * @class TraceRecorder
+ * @brief Singleton recording when things happened during processing
+ *
+ * Spans of time (processor calls, file opening, filling the output tree,
+ * loading conditions, ...) and instants (new runs) are kept in a ring
+ * buffer, so only the most recent ones are kept if there are more than
+ * it can hold. At the end of processing, the buffer is written in the
+ * Chrome Trace Event JSON format, which can be loaded into a trace
+ * viewer like Perfetto or chrome://tracing.
+ *
+ * Recording is off until enable is called, and then it is safe to
+ * record from several threads at once. Each thread gets its own row
+ * in the timeline.
+ */
+class TraceRecorder {
+ public:
+  /// @return The TraceRecorder instance
+  static TraceRecorder &getInstance();
+
+  /**
+   * Start recording
+   *
+   * The buffer starts small and grows as records are added, up to
+   * the maximum, so a short job doesn't pay for a large maximum.
+   *
+   * @param capacity maximum number of records to keep
+   */
+  void enable(std::size_t capacity);
+
+  /**
+   * Check if recording is on
+   *
+   * @return true if records are being kept
+   */
+  bool isEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  /**
+   * Record a span of time
+   *
+   * @param category kind of span, e.g. "module" or "io"
+   * @param name name of span
+   * @param start time the span started
+   * @param eventNumber number of the event the span is for, negative if none
+   */
+  void span(const char *category, const std::string &name,
+            std::chrono::steady_clock::time_point start, long eventNumber = -1);
+
+  /**
+   * Record an instant
+   *
+   * @param category kind of instant, e.g. "run"
+   * @param name name of instant
+   */
+  void instant(const char *category, const std::string &name);
+
+  /**
+   * Write the records to a file in Chrome Trace Event JSON format
+   *
+   * @param fileName name of file to write
+   */
+  void write(const std::string &fileName) const;
+
+  /**
+   * @class Scope
+   * @brief Records a span from its construction to its destruction
+   *
+   * Nothing is done if recording is off, the name isn't even copied,
+   * so a scope costs next to nothing in jobs that aren't traced.
+   */
+  class Scope {
+   public:
+    /**
+     * Start the span
+     *
+     * @param category kind of span
+     * @param name name of span
+     * @param eventNumber number of the event the span is for
+     */
+    Scope(const char *category, const char *name, long eventNumber = -1);
+
+    /**
+     * Start the span with a name made of two parts
+     *
+     * The parts are only put together if recording is on.
+     *
+     * @param category kind of span
+     * @param prefix start of name of span, e.g. "open "
+     * @param suffix rest of name of span, e.g. the file name
+     */
+    Scope(const char *category, const char *prefix, const std::string &suffix);
+
+    /// Record the span
+    ~Scope();
+
+   private:
+    /// Kind of span, null if recording is off
+    const char *category_{nullptr};
+    /// Name of span
+    std::string name_;
+    /// Number of the event the span is for
+    long eventNumber_;
+    /// Time the span started
+    std::chrono::steady_clock::time_point start_;
+  };
+
+ private:
+  /// Constructor hidden, use getInstance
+  TraceRecorder() = default;
+
+  /**
+   * One entry in the timeline
+   */
+  struct Record {
+    /// Kind of record
+    const char *category;
+    /// Name of record
+    std::string name;
+    /// Phase in the Chrome trace format, 'X' for spans and 'i' for instants
+    char phase;
+    /// Time since recording started [us]
+    double start;
+    /// Length of span [us]
+    double duration;
+    /// Index of the thread that made the record
+    int thread;
+    /// Number of the event the record is for, negative if none
+    long eventNumber;
+  };
+
+  /**
+   * Put a record in the ring buffer
+   *
+   * @param record Record to keep
+   */
+  void push(Record &&record);
+
+  /**
+   * Get the index of the calling thread
+   *
+   * @return small integer identifying the thread
+   */
+  static int threadIndex();
+
+  /// True if records are being kept
+  std::atomic<bool> enabled_{false};
+
+  /// Time recording started
+  std::chrono::steady_clock::time_point origin_;
+
+  /// Ring buffer of records, grown up to the capacity as records are added
+  std::vector<Record> records_;
+
+  /// Maximum number of records kept
+  std::size_t capacity_{0};
+
+  /// Index in the ring buffer to put the next record
+  std::size_t next_{0};
+
+  /// True once the ring buffer has wrapped around
+  bool wrapped_{false};
+
+  /// Guard for the ring buffer
+  mutable std::mutex mutex_;
+};
+
+}  // namespace framework
+
+#endif  // FRAMEWORK_TRACERECORDER_H_
@@ -0,0 +1,96 @@
+/**
+ * @file AllocationCounter.cxx
+ * Replacements of the global allocation functions, counting each call
+ * when tracking is on. The aligned versions are left to the standard
+ * library; they use their own allocation and deallocation pair.
+ */
+
+#include "Framework/AllocationCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+/// Counts of each tag
+framework::AllocationCounter counter;
+
+/// Tag of what the calling thread is running
+thread_local int currentTag{0};
+
+/// Count an allocation against the tag of this thread
+inline void countAllocation(std::size_t size) noexcept {
+  if (not counter.tracking.load(std::memory_order_relaxed)) return;
+  framework::AllocationCounter::Counts &tag{counter.counts[currentTag]};
+  tag.allocations.fetch_add(1, std::memory_order_relaxed);
+  tag.bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+/// Count a deallocation against the tag of this thread
+inline void countFree(void *ptr) noexcept {
+  if (ptr == nullptr or not counter.tracking.load(std::memory_order_relaxed))
+    return;
+  counter.counts[currentTag].frees.fetch_add(1, std::memory_order_relaxed);
+}
+
+/// Allocate like the default operator new, counting the allocation
+void *allocate(std::size_t size) {
+  countAllocation(size);
+  if (size == 0) size = 1;
+  while (true) {
+    void *ptr = std::malloc(size);
+    if (ptr) return ptr;
+    std::new_handler handler = std::get_new_handler();
+    if (not handler) throw std::bad_alloc();
+    handler();
+  }
+}
+
+/// Allocate like the default nothrow operator new, counting the allocation
+void *allocateNoThrow(std::size_t size) noexcept {
+  try {
+    return allocate(size);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+/// Deallocate like the default operator delete, counting the deallocation
+void deallocate(void *ptr) noexcept {
+  countFree(ptr);
+  std::free(ptr);
+}
+
+}  // namespace
+
+framework::AllocationCounter *frameworkAllocationCounter() { return &counter; }
+
+int *frameworkAllocationTag() { return &currentTag; }
+
+void *operator new(std::size_t size) { return allocate(size); }
+
+void *operator new[](std::size_t size) { return allocate(size); }
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  return allocateNoThrow(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return allocateNoThrow(size);
+}
+
+void operator delete(void *ptr) noexcept { deallocate(ptr); }
+
+void operator delete[](void *ptr) noexcept { deallocate(ptr); }
+
+void operator delete(void *ptr, std::size_t) noexcept { deallocate(ptr); }
+
+void operator delete[](void *ptr, std::size_t) noexcept { deallocate(ptr); }
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept {
+  deallocate(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept {
+  deallocate(ptr);
+}
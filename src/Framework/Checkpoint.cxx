@@ -0,0 +1,89 @@
+#include "Framework/Checkpoint.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include "Framework/Exception/Exception.h"
+
+namespace framework {
+
+void Checkpoint::write(const std::string &fileName) const {
+  // write next to the checkpoint and then swap it in,
+  //  so a job killed while writing leaves the last checkpoint intact
+  std::string tmpName{fileName + ".tmp"};
+  {
+    std::ofstream file(tmpName);
+    if (not file) {
+      EXCEPTION_RAISE("Checkpoint", "Unable to open '" + tmpName +
+                                        "' to write checkpoint.");
+    }
+    file << "eventsProcessed " << eventsProcessed << "\n"
+         << "inputFileIndex " << inputFileIndex << "\n"
+         << "inputFile " << inputFile << "\n"
+         << "nextEntry " << nextEntry << "\n"
+         << "outputEntries " << outputEntries << "\n";
+    if (hasMasterSeed)
+      file << "masterSeed " << run << " " << masterSeed << "\n";
+    file << "end\n";
+    if (not file.flush()) {
+      EXCEPTION_RAISE("Checkpoint",
+                      "Unable to write checkpoint to '" + tmpName + "'.");
+    }
+  }
+  if (std::rename(tmpName.c_str(), fileName.c_str()) != 0) {
+    EXCEPTION_RAISE("Checkpoint", "Unable to move checkpoint '" + tmpName +
+                                      "' to '" + fileName + "'.");
+  }
+}
+
+Checkpoint Checkpoint::read(const std::string &fileName) {
+  std::ifstream file(fileName);
+  if (not file) {
+    EXCEPTION_RAISE("Checkpoint",
+                    "Unable to open checkpoint '" + fileName + "' to resume.");
+  }
+
+  Checkpoint checkpoint;
+  bool complete{false};
+  std::string line;
+  while (std::getline(file, line)) {
+    std::string key{line.substr(0, line.find(' '))};
+    std::string value{key.size() < line.size() ? line.substr(key.size() + 1)
+                                               : ""};
+    std::istringstream number(value);
+    if (key == "eventsProcessed") {
+      number >> checkpoint.eventsProcessed;
+    } else if (key == "inputFileIndex") {
+      number >> checkpoint.inputFileIndex;
+    } else if (key == "inputFile") {
+      checkpoint.inputFile = value;
+    } else if (key == "nextEntry") {
+      number >> checkpoint.nextEntry;
+    } else if (key == "outputEntries") {
+      number >> checkpoint.outputEntries;
+    } else if (key == "masterSeed") {
+      number >> checkpoint.run >> checkpoint.masterSeed;
+      checkpoint.hasMasterSeed = true;
+    } else if (key == "end") {
+      complete = true;
+    }
+  }
+
+  if (not complete) {
+    EXCEPTION_RAISE("Checkpoint",
+                    "Checkpoint '" + fileName + "' is incomplete.");
+  }
+  return checkpoint;
+}
+
+std::string Checkpoint::resumedFileName(const std::string &name,
+                                        int eventsProcessed) {
+  std::string suffix{"_resume" + std::to_string(eventsProcessed)};
+  auto extension{name.rfind('.')};
+  if (extension == std::string::npos or
+      name.find('/', extension) != std::string::npos)
+    return name + suffix;
+  return name.substr(0, extension) + suffix + name.substr(extension);
+}
+
+}  // namespace framework
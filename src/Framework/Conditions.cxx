@@ -1,10 +1,24 @@
 #include "Framework/Conditions.h"
+#include <algorithm>
+#include <iomanip>
+#include <mutex>
 #include <sstream>
 #include "Framework/PluginFactory.h"
 #include "Framework/Process.h"
+#include "Framework/TraceRecorder.h"
 
 namespace framework {
 
+/**
+ * Guard for the cache of conditions
+ *
+ * Several streams may ask for conditions at once, there is only one
+ * Process (and so one Conditions) so this doesn't need to be a member.
+ * It is recursive because providers ask for the conditions they are
+ * built from while the cache is being updated.
+ */
+static std::recursive_mutex cacheMutex;
+
 Conditions::Conditions(Process& p) : process_{p} {}
 
 void Conditions::createConditionsObjectProvider(
@@ -35,25 +49,61 @@ void Conditions::onProcessStart() {
 }
 
 void Conditions::onProcessEnd() {
+  releaseEvicted();
   for (auto ptr : providerMap_) ptr.second->onProcessEnd();
 }
 
+void Conditions::newEpoch() {
+  epoch_++;
+  releaseEvicted();
+}
+
+void Conditions::releaseEvicted() {
+  std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+  for (auto [provider, obj] : evicted_) provider->releaseConditionsObject(obj);
+  evicted_.clear();
+}
+
 void Conditions::onNewRun(ldmx::RunHeader& rh) {
+  // handles look their objects up again, their IOVs may have ended
+  newEpoch();
   for (auto ptr : providerMap_) ptr.second->onNewRun(rh);
 }
 
 ConditionsIOV Conditions::getConditionIOV(
     const std::string& condition_name) const {
+  std::lock_guard<std::recursive_mutex> lock(cacheMutex);
   auto cacheptr = cache_.find(condition_name);
-  if (cacheptr == cache_.end())
+  if (cacheptr == cache_.end() or cacheptr->second.versions.empty())
     return ConditionsIOV();
   else
-    return cacheptr->second.iov;
+    return cacheptr->second.versions.at(cacheptr->second.current).iov;
+}
+
+std::string Conditions::summary() const {
+  std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+  std::size_t width{9};
+  for (auto const& [name, entry] : cache_) width = std::max(width, name.size());
+
+  std::stringstream table;
+  table << std::left << std::setw(width) << "Condition" << std::right
+        << std::setw(12) << "Hits" << std::setw(12) << "Misses"
+        << std::setw(10) << "Kept";
+  for (auto const& [name, entry] : cache_) {
+    table << "\n"
+          << std::left << std::setw(width) << name << std::right
+          << std::setw(12) << entry.hits << std::setw(12) << entry.misses
+          << std::setw(10)
+          << (std::to_string(entry.versions.size()) + "/" +
+              std::to_string(entry.provider->getCacheSize()));
+  }
+  return table.str();
 }
 
 const ConditionsObject* Conditions::getConditionPtr(
     const std::string& condition_name) {
   const ldmx::EventHeader& context = *(process_.getEventHeader());
+  std::lock_guard<std::recursive_mutex> lock(cacheMutex);
   auto cacheptr = cache_.find(condition_name);
 
   if (cacheptr == cache_.end()) {
@@ -65,49 +115,89 @@ const ConditionsObject* Conditions::getConditionPtr(
           std::string("No provider is available for : " + condition_name));
     }
 
-    std::pair<const ConditionsObject*, ConditionsIOV> cond =
-        copptr->second->getCondition(context);
-
-    if (!cond.first) {
-      EXCEPTION_RAISE(
-          "ConditionUnavailable",
-          std::string("Null condition returned for requested item : " +
-                      condition_name));
-    }
-
     // first request, create a cache entry
     CacheEntry ce;
-    ce.iov = cond.second;
-    ce.obj = cond.first;
     ce.provider = copptr->second;
-    cache_[condition_name] = ce;
-    return ce.obj;
-  } else {
-    /// if still valid, we return what we have
-    if (cacheptr->second.iov.validForEvent(context))
-      return cacheptr->second.obj;
-    else {
-      // if not, we release the old object
-      cacheptr->second.provider->releaseConditionsObject(cacheptr->second.obj);
-      // now ask for a new one
-      std::pair<const ConditionsObject*, ConditionsIOV> cond =
-          cacheptr->second.provider->getCondition(context);
-
-      if (!cond.first) {
-        std::stringstream s;
-        s << "Unable to update condition '" << condition_name << "' for event "
-          << context.getEventNumber() << " run " << context.getRun();
-        if (context.isRealData())
-          s << " DATA";
-        else
-          s << " MC";
-        EXCEPTION_RAISE("ConditionUnavailable", s.str());
-      }
-      cacheptr->second.iov = cond.second;
-      cacheptr->second.obj = cond.first;
-      return cond.first;
+    cacheptr = cache_.emplace(condition_name, ce).first;
+  }
+
+  CacheEntry& entry{cacheptr->second};
+  lookups_++;
+
+  /// if still valid, we return what we have
+  if (not entry.versions.empty() and
+      entry.versions.at(entry.current).iov.validForEvent(context)) {
+    entry.hits++;
+    entry.versions.at(entry.current).lastUsed = lookups_;
+    return entry.versions.at(entry.current).obj;
+  }
+
+  // an older version may be valid, e.g. when input goes back to a run
+  for (std::size_t i = 0; i < entry.versions.size(); i++) {
+    if (entry.versions.at(i).iov.validForEvent(context)) {
+      entry.hits++;
+      entry.current = i;
+      entry.versions.at(i).lastUsed = lookups_;
+      return entry.versions.at(i).obj;
     }
   }
+
+  entry.misses++;
+  TraceRecorder::Scope trace("conditions", entry.loaded ? "reload " : "load ",
+                             condition_name);
+
+  // now ask for a new one
+  std::pair<const ConditionsObject*, ConditionsIOV> cond =
+      entry.provider->getCondition(context);
+
+  if (!cond.first and not entry.loaded) {
+    EXCEPTION_RAISE(
+        "ConditionUnavailable",
+        std::string("Null condition returned for requested item : " +
+                    condition_name));
+  } else if (!cond.first) {
+    std::stringstream s;
+    s << "Unable to update condition '" << condition_name << "' for event "
+      << context.getEventNumber() << " run " << context.getRun();
+    if (context.isRealData())
+      s << " DATA";
+    else
+      s << " MC";
+    EXCEPTION_RAISE("ConditionUnavailable", s.str());
+  }
+
+  // a provider may give the object it already gave with a new IOV,
+  //  even one that was evicted but not released yet
+  evicted_.erase(std::remove_if(evicted_.begin(), evicted_.end(),
+                                [&cond](const auto& version) {
+                                  return version.second == cond.first;
+                                }),
+                 evicted_.end());
+  auto same = std::find_if(entry.versions.begin(), entry.versions.end(),
+                           [&cond](const Version& version) {
+                             return version.obj == cond.first;
+                           });
+  if (same == entry.versions.end())
+    same = entry.versions.insert(same, {cond.second, cond.first, lookups_});
+  else
+    *same = {cond.second, cond.first, lookups_};
+  entry.current = same - entry.versions.begin();
+  entry.loaded = true;
+
+  // evict the least recently used version if there are too many, it is
+  //  released once no event can be reading it
+  if (entry.versions.size() > std::size_t(entry.provider->getCacheSize())) {
+    // the version just used has the latest lookup, so it is never evicted
+    auto oldest = std::min_element(
+        entry.versions.begin(), entry.versions.end(),
+        [](const Version& lhs, const Version& rhs) {
+          return lhs.lastUsed < rhs.lastUsed;
+        });
+    if (oldest < same) entry.current--;
+    evicted_.emplace_back(entry.provider, oldest->obj);
+    entry.versions.erase(oldest);
+  }
+  return cond.first;
 }
 
 }  // namespace framework
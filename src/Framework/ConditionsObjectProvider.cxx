@@ -1,5 +1,7 @@
 #include "Framework/ConditionsObjectProvider.h"
 
+#include <algorithm>
+
 // LDMX
 #include "Framework/PluginFactory.h"
 #include "Framework/Process.h"
@@ -12,6 +14,7 @@ ConditionsObjectProvider::ConditionsObjectProvider(
     : process_{process},
       objectName_{objname},
       tagname_{tagname},
+      cacheSize_{std::max(params.getParameter<int>("cacheSize", 1), 1)},
       theLog_{logging::makeLogger(objname)} {}
 
 std::pair<const ConditionsObject*, ConditionsIOV>
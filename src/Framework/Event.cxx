@@ -1,13 +1,26 @@
 #include "Framework/Event.h"
 
+#include <atomic>
+#include <chrono>
+
+#include "Framework/MemoryTracker.h"
+
 namespace framework {
 
+int makeProductHandleId() {
+  static std::atomic<int> nextId{0};
+  return nextId++;
+}
+
 Event::Event(const std::string& thePassName) : passName_(thePassName) {}
 
 Event::~Event() {
   for (regex_t& reg : regexDropCollections_) {
     regfree(&reg);
   }
+  for (BranchRule& rule : branchRules_) {
+    regfree(&rule.exp);
+  }
 }
 
 void Event::Print(int verbosity) const {
@@ -27,9 +40,37 @@ void Event::addDrop(const std::string& exp) {
   }
 }
 
+bool Event::exists(const std::string& name,
+                   const std::string& passName) const {
+  auto lock{lockBus()};
+  auto itName = productsByName_.find(name);
+  if (itName == productsByName_.end()) return false;
+  if (passName.empty()) return (itName->second.size() == 1);
+  return (std::count_if(itName->second.begin(), itName->second.end(),
+                        [&](std::size_t i) {
+                          return products_.at(i).passname() == passName;
+                        }) == 1);
+}
+
+void Event::addBranchRule(const std::string& exp, int basketSize,
+                          int splitLevel) {
+  regex_t reg;
+  if (!regcomp(&reg, exp.c_str(), REG_EXTENDED | REG_ICASE | REG_NOSUB)) {
+    branchRules_.push_back({reg, basketSize, splitLevel});
+  } else {
+    EXCEPTION_RAISE("InvalidRegex", "The passed branch rule regex '" + exp +
+                                        "' is not a valid regex.");
+  }
+}
+
 std::vector<ProductTag> Event::searchProducts(
     const std::string& namematch, const std::string& passmatch,
     const std::string& typematch) const {
+  auto lock{lockBus()};
+  std::string query{namematch + '\0' + passmatch + '\0' + typematch};
+  auto itCached = searchCache_.find(query);
+  if (itCached != searchCache_.end()) return itCached->second;
+
   std::vector<ProductTag> retval;
 
   regex_t reg_name, reg_pass, reg_type;
@@ -69,6 +110,7 @@ std::vector<ProductTag> Event::searchProducts(
                                     "' is not a valid regular expression.");
   }
 
+  searchCache_[query] = retval;
   return retval;
 }
 
@@ -78,7 +120,20 @@ TTree* Event::createTree() {
   return outputTree_;
 }
 
-void Event::setOutputTree(TTree* tree) { outputTree_ = tree; }
+void Event::setOutputTree(TTree* tree) {
+  outputTree_ = tree;
+
+  // branches copied from the input tree were made with the input settings
+  //  only the basket size can be changed after the fact
+  if (branchRules_.empty() or outputTree_ == nullptr) return;
+  TObjArray* branches = outputTree_->GetListOfBranches();
+  for (int i = 0; i < branches->GetEntriesFast(); i++) {
+    auto branch = dynamic_cast<TBranch*>(branches->At(i));
+    const BranchRule& settings{getBranchRule(branch->GetName())};
+    if (&settings != &defaultBranchRule_)
+      branch->SetBasketSize(settings.basketSize);
+  }
+}
 
 void Event::setInputTree(TTree* tree) {
   inputTree_ = tree;
@@ -87,12 +142,14 @@ void Event::setInputTree(TTree* tree) {
   // in some cases, setInputTree is called more than once,
   // so reset branch listing before starting
   products_.clear();
+  productsByName_.clear();
   branchNames_.clear();
   branches_.clear();
-  passengers_.clear();
+  retirePassengers();
+  resetSlots();
 
   // put in EventHeader (only one without pass name)
-  products_.emplace_back(ldmx::EventHeader::BRANCH, "", "ldmx::EventHeader");
+  addProduct(ldmx::EventHeader::BRANCH, "", "ldmx::EventHeader");
 
   // find the names of all the existing branches
   TObjArray* branches = inputTree_->GetListOfBranches();
@@ -104,7 +161,7 @@ void Event::setInputTree(TTree* tree) {
       std::string pname = brname.substr(j + 1);
       std::string tname =
           dynamic_cast<TBranchElement*>(branches->At(i))->GetClassName();
-      products_.emplace_back(iname, pname, tname);
+      addProduct(iname, pname, tname);
     }
     branchNames_.push_back(brname);
   }
@@ -125,19 +182,77 @@ void Event::beforeFill() {
   }
 }
 
+void Event::takeProducts(Event& other) {
+  // go through the products so the names don't need to be parsed
+  //  out of the branch names
+  for (auto const& product : other.products_) {
+    if (product.passname() != other.passName_) continue;
+    std::string branchName{
+        other.makeBranchName(product.name(), product.passname())};
+    if (other.branchesFilled_.find(branchName) == other.branchesFilled_.end())
+      continue;
+    std::visit(
+        [&](auto& obj) {
+          add(product.name(), std::move(obj), SortPolicy::Unordered);
+        },
+        other.passengers_.at(branchName));
+  }
+}
+
 void Event::Clear() {
+  MemoryTracker::Scope memory(MemoryTracker::Clear);
   // clear the event objects
   branchesFilled_.clear();
-  for (auto passenger : passengers_) {
-    std::visit(clearPassenger(), passenger.second);
+  for (auto& producer : onDemand_) producer.triggered = false;
+  for (auto& slot : slots_) slot.filled = false;
+  std::size_t footprint{0};
+  for (auto& [branchName, passenger] : passengers_) {
+    footprint += std::visit(passengerFootprint(), passenger);
+    // passengers bound to an input branch are overwritten when the
+    // next entry is read, so there is no need to clear them
+    if (branches_.find(branchName) != branches_.end()) continue;
+    std::visit(clearPassenger(), passenger);
   }
+  busHighWaterMark_ = std::max(busHighWaterMark_, footprint);
 }
 
 void Event::onEndOfEvent() {}
 
+std::size_t Event::addOnDemand(const std::vector<std::string>& collectionNames,
+                               std::function<void()> produce) {
+  std::size_t index{onDemand_.size()};
+  onDemand_.emplace_back();
+  onDemand_.back().produce = std::move(produce);
+  for (auto const& name : collectionNames) onDemandProducts_[name] = index;
+  return index;
+}
+
+void Event::runOnDemand(std::size_t index) const {
+  OnDemandProducer& producer{onDemand_.at(index)};
+  std::lock_guard<std::recursive_mutex> lock(producer.running);
+  if (producer.triggered) return;
+  // marked first so that requests for its own products don't recurse
+  producer.triggered = true;
+  producer.produce();
+}
+
+bool Event::isPersisted(const std::string& collectionName) const {
+  return outputTree_ != nullptr and
+         not shouldDrop(makeBranchName(collectionName));
+}
+
+void Event::requestOnDemand(const std::string& collectionName,
+                            const std::string& passName) const {
+  if (not passName.empty() and passName != passName_) return;
+  auto itProducer = onDemandProducts_.find(collectionName);
+  if (itProducer == onDemandProducts_.end()) return;
+  runOnDemand(itProducer->second);
+}
+
 void Event::onEndOfFile() {
-  passengers_.clear();  // reset event bus
+  retirePassengers();   // reset event bus, keeping passenger storage
   branches_.clear();    // reset branches
+  resetSlots();         // handles need to re-bind to new passengers
   if (outputTree_)
     outputTree_->ResetBranchAddresses();  // reset addresses for output branch
   if (inputTree_)
@@ -146,6 +261,157 @@ void Event::onEndOfFile() {
   entries_ = -1;
 }
 
+void Event::readEntry(TBranchElement* branch, Long64_t entry) const {
+  auto start = std::chrono::steady_clock::now();
+  {
+    MemoryTracker::Scope memory(MemoryTracker::Read);
+    branch->GetEntry(entry);
+  }
+  inputStallTime_ += std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+}
+
+void Event::addProduct(const std::string& name, const std::string& passName,
+                       const std::string& typeName) {
+  productsByName_[name].push_back(products_.size());
+  products_.emplace_back(name, passName, typeName);
+  // have to invalidate the caches of lookups
+  knownLookups_.clear();
+  searchCache_.clear();
+}
+
+void Event::retirePassengers() {
+  for (auto& [branchName, passenger] : passengers_) {
+    std::visit(clearPassenger(), passenger);
+  }
+  // merge leaves behind any passengers that already have a spare,
+  // those are the only ones that are deallocated
+  sparePassengers_.merge(passengers_);
+  passengers_.clear();
+}
+
+std::string Event::resolveBranchName(const std::string& collectionName,
+                                     const std::string& passName) const {
+  std::string branchName;
+  if (not findBranchName(collectionName, passName, branchName)) {
+    EXCEPTION_RAISE("ProductNotFound",
+                    "No product found for name '" + collectionName + "'");
+  }
+  return branchName;
+}
+
+bool Event::findBranchName(const std::string& collectionName,
+                           const std::string& passName,
+                           std::string& branchName) const {
+  if (collectionName == ldmx::EventHeader::BRANCH) {
+    branchName = collectionName;
+    return true;
+  }
+
+  if (not passName.empty()) {
+    branchName = makeBranchName(collectionName, passName);
+    return true;
+  }
+
+  // if no passName, then find branchName by looking over known branches
+  auto itKL = knownLookups_.find(collectionName);
+  if (itKL != knownLookups_.end()) {
+    branchName = itKL->second;
+    return true;
+  }
+
+  // this collecitonName hasn't been found before
+  auto itName = productsByName_.find(collectionName);
+  if (itName == productsByName_.end() or itName->second.empty()) {
+    // no matches found
+    return false;
+  } else if (itName->second.size() > 1) {
+    // more than one branch found
+    std::string names;
+    for (std::size_t i : itName->second) {
+      if (!names.empty()) names += ", ";
+      names += makeBranchName(collectionName, products_.at(i).passname());
+    }
+    EXCEPTION_RAISE("ProductAmbiguous",
+                    "Multiple products found for name '" + collectionName +
+                        "' without specified pass name (" + names + ")");
+  }
+
+  // exactly one branch found
+  branchName = makeBranchName(collectionName,
+                              products_.at(itName->second.front()).passname());
+  knownLookups_[collectionName] = branchName;
+  return true;
+}
+
+int Event::findSlot(const std::string& collectionName,
+                    const std::string& passName, bool produced) const {
+  for (std::size_t i{0}; i < slots_.size(); i++) {
+    const ProductSlot& slot{slots_.at(i)};
+    if (slot.produced == produced and slot.collectionName == collectionName and
+        slot.passName == passName)
+      return i;
+  }
+
+  slots_.emplace_back();
+  slots_.back().collectionName = collectionName;
+  slots_.back().passName = passName;
+  slots_.back().produced = produced;
+  return slots_.size() - 1;
+}
+
+int Event::resolveHandle(int id, const std::string& collectionName,
+                         const std::string& passName, bool produced) const {
+  if (id < 0) {
+    EXCEPTION_RAISE("EmptyHandle",
+                    "Attempting to access the event bus with an empty "
+                    "ProductHandle.");
+  }
+  if (std::size_t(id) >= handleSlots_.size()) handleSlots_.resize(id + 1, -1);
+  if (handleSlots_[id] < 0)
+    handleSlots_[id] = findSlot(collectionName, passName, produced);
+  return handleSlots_[id];
+}
+
+void Event::bindSlot(ProductSlot& slot, const std::string& branchName) const {
+  slot.branchName = branchName;
+  slot.passenger = &passengers_.at(branchName);
+  auto itBranch = branches_.find(branchName);
+  slot.branch = (itBranch != branches_.end()) ? itBranch->second : nullptr;
+  if (slot.produced) producedSlots_[branchName] = &slot - slots_.data();
+}
+
+void Event::markSlotFilled(const std::string& branchName) {
+  auto itSlot = producedSlots_.find(branchName);
+  if (itSlot == producedSlots_.end()) return;
+  ProductSlot& slot{slots_.at(itSlot->second)};
+  if (slot.filled) {
+    EXCEPTION_RAISE("ProductExists",
+                    "A product named '" + slot.collectionName +
+                        "' already exists in the event (has been loaded by a "
+                        "previous producer in this process).");
+  }
+  slot.filled = true;
+}
+
+void Event::resetSlots() {
+  for (auto& slot : slots_) {
+    slot.passenger = nullptr;
+    slot.branch = nullptr;
+    slot.filled = false;
+  }
+  producedSlots_.clear();
+}
+
+const Event::BranchRule& Event::getBranchRule(
+    const std::string& branchName) const {
+  for (auto rule = branchRules_.rbegin(); rule != branchRules_.rend(); rule++) {
+    if (!regexec(&rule->exp, branchName.c_str(), 0, 0, 0)) return *rule;
+  }
+  return defaultBranchRule_;
+}
+
 bool Event::shouldDrop(const std::string& branchName) const {
   for (const regex_t& exp : regexDropCollections_) {
     if (!regexec(&exp, branchName.c_str(), 0, 0, 0)) return true;
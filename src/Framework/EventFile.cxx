@@ -1,12 +1,17 @@
+#include <chrono>
 #include <ctime>
 
+#include "TEnv.h"
+#include "TTreeCacheUnzip.h"
 #include "TTreeReader.h"
 
 // LDMX
 #include "Framework/Event.h"
 #include "Framework/EventFile.h"
 #include "Framework/Exception/Exception.h"
+#include "Framework/MemoryTracker.h"
 #include "Framework/RunHeader.h"
+#include "Framework/TraceRecorder.h"
 
 namespace framework {
 
@@ -15,6 +20,7 @@ EventFile::EventFile(const framework::config::Parameters &params,
                      bool isOutputFile, bool isSingleOutput, bool isLoopable)
     : fileName_(filename), parent_(parent), isOutputFile_(isOutputFile),
       isSingleOutput_(isSingleOutput), isLoopable_(isLoopable) {
+  TraceRecorder::Scope trace("io", "open ", fileName_);
 
   if (isOutputFile_) {
     // we are writting out so open the file and make sure it is writable
@@ -31,6 +37,24 @@ EventFile::EventFile(const framework::config::Parameters &params,
     file_->SetCompressionSettings(
         params.getParameter<int>("compressionSetting", 9));
 
+    lazyBranchLoading_ = params.getParameter<bool>("lazyBranchLoading", false);
+
+    // fix the cluster boundaries by number of events or size [MB]
+    //  so they don't depend on the content of the file
+    auto clusterEvents{params.getParameter<int>("clusterEvents", 0)};
+    auto clusterSize{params.getParameter<int>("clusterSize", 0)};
+    if (clusterEvents > 0)
+      autoFlush_ = clusterEvents;
+    else if (clusterSize > 0)
+      autoFlush_ = -Long64_t(clusterSize) * 1024 * 1024;
+    autoSave_ = params.getParameter<int>("autoSaveEvents", 0);
+
+    // after this many events, resize the baskets to fit the budget [MB]
+    basketAutoTuneEvents_ = params.getParameter<int>("basketAutoTuneEvents", 0);
+    basketMemoryBudget_ =
+        Long64_t(params.getParameter<int>("basketMemoryBudget", 10)) * 1024 *
+        1024;
+
     if (parent_) {
       // output file when there are input files
       //  might be drop/keep rules, so we should have these rules to make sure
@@ -48,6 +72,11 @@ EventFile::EventFile(const framework::config::Parameters &params,
       reactivateRules_.push_back("*");
     }
   } else {
+    // read-ahead on a background thread needs to be set before the
+    // file is opened
+    bool readAhead{params.getParameter<bool>("inputReadAhead", false)};
+    if (readAhead) gEnv->SetValue("TFile.AsyncPrefetching", 1);
+
     // open file with only reading enabled
     file_ = new TFile(fileName_.c_str());
     // double check that file is open
@@ -65,6 +94,15 @@ EventFile::EventFile(const framework::config::Parameters &params,
                                        tree_name + "' in it.");
     }
     entries_ = tree_->GetEntriesFast();
+
+    // baskets of the next cluster are read (and unzipped in parallel)
+    // into the tree cache while the current cluster is processed
+    //  the cache size [MB] bounds the memory used, negative leaves ROOT's
+    //  default and zero turns the cache off
+    if (readAhead) TTreeCacheUnzip::SetParallelUnzip(TTreeCacheUnzip::kEnable);
+    auto cacheSize{params.getParameter<int>("inputCacheSize", -1)};
+    if (cacheSize >= 0) tree_->SetCacheSize(Long64_t(cacheSize) * 1024 * 1024);
+    if (readAhead) tree_->SetClusterPrefetch(true);
   }
 
   importRunHeaders();
@@ -145,6 +183,39 @@ void EventFile::addDrop(const std::string &rule) {
   }
 }
 
+void EventFile::addConsumed(const ProductTag &tag) {
+  consumed_.push_back(tag);
+}
+
+void EventFile::activateNeededBranches() {
+  TTree *input{parent_->tree_};
+
+  // turn everything off and then turn on what we need,
+  //  so that overlapping wildcards can only turn on extra branches
+  input->SetBranchStatus("*", 0);
+
+  TObjArray *branches = input->GetListOfBranches();
+  for (int i = 0; i < branches->GetEntriesFast(); i++) {
+    std::string brname = branches->At(i)->GetName();
+
+    // EventHeader is always read and branches in the output tree
+    // need to be read so they can be copied
+    bool needed = (brname == ldmx::EventHeader::BRANCH) or
+                  (tree_->GetBranch(brname.c_str()) != nullptr);
+
+    size_t j = brname.find("_");
+    std::string iname = brname.substr(0, j);
+    std::string pname = (j == std::string::npos) ? "" : brname.substr(j + 1);
+    for (auto const &tag : consumed_) {
+      if (needed) break;
+      needed = (tag.name() == iname) and
+               (tag.passname().empty() or tag.passname() == pname);
+    }
+
+    if (needed) input->SetBranchStatus((brname + "*").c_str(), 1);
+  }
+}
+
 bool EventFile::nextEvent(bool storeCurrentEvent) {
   if (ientry_ < 0 && parent_) {
     if (!parent_->tree_) {
@@ -165,10 +236,16 @@ bool EventFile::nextEvent(bool storeCurrentEvent) {
                                         rulePair.second);
 
       tree_ = parent_->tree_->CloneTree(0);
-
-      // reactivate any drop branches (drop) on input tree
-      for (auto const &rule : reactivateRules_)
-        parent_->tree_->SetBranchStatus(rule.c_str(), 1);
+      configureOutputTree();
+
+      if (lazyBranchLoading_) {
+        // only read what is needed
+        activateNeededBranches();
+      } else {
+        // reactivate any drop branches (drop) on input tree
+        for (auto const &rule : reactivateRules_)
+          parent_->tree_->SetBranchStatus(rule.c_str(), 1);
+      }
     }
     event_->setInputTree(parent_->tree_);
     event_->setOutputTree(tree_);
@@ -178,8 +255,16 @@ bool EventFile::nextEvent(bool storeCurrentEvent) {
   if (ientry_ >= 0) {
     if (isOutputFile_) {
       event_->beforeFill();
-      if (storeCurrentEvent)
+      if (storeCurrentEvent) {
+        TraceRecorder::Scope trace("io", "Fill");
+        MemoryTracker::Scope memory(MemoryTracker::Fill);
         tree_->Fill(); // fill the clones...
+        // now that we know how large each product is, split the memory
+        // budget between the branches in proportion to their size
+        if (basketAutoTuneEvents_ > 0 and
+            tree_->GetEntries() == basketAutoTuneEvents_)
+          tree_->OptimizeBaskets(basketMemoryBudget_, 1.1, "");
+      }
     }
     if (event_) {
       event_->Clear();
@@ -191,7 +276,16 @@ bool EventFile::nextEvent(bool storeCurrentEvent) {
     if (!parent_->nextEvent()) {
       return false;
     }
-    parent_->tree_->GetEntry(parent_->ientry_);
+    auto start = std::chrono::steady_clock::now();
+    {
+      MemoryTracker::Scope memory(MemoryTracker::Read);
+      parent_->tree_->GetEntry(parent_->ientry_);
+    }
+    event_->addInputStallTime(std::chrono::duration<double>(
+                                  std::chrono::steady_clock::now() - start)
+                                  .count());
+    if (TraceRecorder::getInstance().isEnabled())
+      TraceRecorder::getInstance().span("io", "GetEntry", start);
     ientry_ = parent_->ientry_;
     event_->nextEvent();
     entries_++;
@@ -230,6 +324,7 @@ void EventFile::setupEvent(Event *evt) {
   if (isOutputFile_) {
     if (!tree_ && !parent_) {
       tree_ = event_->createTree();
+      configureOutputTree();
       ientry_ = 0;
       entries_ = 0;
     }
@@ -266,9 +361,14 @@ void EventFile::updateParent(EventFile *parent) {
     // Copy over addresses from the new parent
     parentTree->CopyAddresses(tree_);
 
-    // and reactivate any dropping rules
-    for (auto const &rule : reactivateRules_)
-      parent_->tree_->SetBranchStatus(rule.c_str(), 1);
+    if (lazyBranchLoading_) {
+      // only read what is needed
+      activateNeededBranches();
+    } else {
+      // and reactivate any dropping rules
+      for (auto const &rule : reactivateRules_)
+        parent_->tree_->SetBranchStatus(rule.c_str(), 1);
+    }
 
     // Reset the entry index with the new parent index
     ientry_ = parent_->ientry_;
@@ -280,7 +380,16 @@ void EventFile::updateParent(EventFile *parent) {
   return;
 }
 
+Long64_t EventFile::saveProgress() {
+  if (not isOutputFile_ or not tree_) return 0;
+  TraceRecorder::Scope trace("io", "save ", fileName_);
+  file_->cd();
+  tree_->AutoSave("SaveSelf");
+  return tree_->GetEntries();
+}
+
 void EventFile::close() {
+  TraceRecorder::Scope trace("io", "close ", fileName_);
   // MEMORY 'Conditional jump or move depends on uninitialised values' when
   // closing TFile and/or writing TTree
   //  TFile::Close --> TDirectoryFile::Close --> ~TTree
@@ -291,6 +400,7 @@ void EventFile::close() {
   // Before an output file, the Event tree needs to be written.
   if (isOutputFile_) {
     tree_->Write();
+    writeClusterLayout();
     // store the run map into the output tree
 
     // Check for the existence of the run tree in the file.
@@ -324,6 +434,27 @@ void EventFile::close() {
   file_->Close();
 }
 
+void EventFile::configureOutputTree() {
+  if (autoFlush_ != 0) tree_->SetAutoFlush(autoFlush_);
+  if (autoSave_ != 0) tree_->SetAutoSave(autoSave_);
+}
+
+void EventFile::writeClusterLayout() {
+  auto clusterTree{new TTree("LDMX_Clusters", "LDMX event tree clusters")};
+  Long64_t first{0}, last{0};
+  clusterTree->Branch("first", &first, "first/L");
+  clusterTree->Branch("last", &last, "last/L");
+
+  Long64_t entries{tree_->GetEntries()};
+  auto clusters{tree_->GetClusterIterator(0)};
+  while ((first = clusters.Next()) < entries) {
+    last = std::min(clusters.GetNextEntry(), entries) - 1;
+    clusterTree->Fill();
+  }
+
+  clusterTree->Write();
+}
+
 void EventFile::writeRunHeader(ldmx::RunHeader &runHeader) {
   int runNumber = runHeader.getRunNumber();
 
@@ -338,13 +469,18 @@ void EventFile::writeRunHeader(ldmx::RunHeader &runHeader) {
 }
 
 ldmx::RunHeader &EventFile::getRunHeader(int runNumber) {
-  if (runMap_.find(runNumber) != runMap_.end()) {
-    return *(runMap_.at(runNumber).second);
-  } else {
+  ldmx::RunHeader *runHeader{findRunHeader(runNumber)};
+  if (runHeader == nullptr) {
     EXCEPTION_RAISE("DataError", "No run header exists for " +
                                      std::to_string(runNumber) +
                                      " in the run map.");
   }
+  return *runHeader;
+}
+
+ldmx::RunHeader *EventFile::findRunHeader(int runNumber) {
+  auto itRun = runMap_.find(runNumber);
+  return itRun == runMap_.end() ? nullptr : itRun->second.second;
 }
 
 void EventFile::importRunHeaders() {
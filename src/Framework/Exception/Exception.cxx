@@ -105,20 +105,19 @@ static char *addr2line(const char *image, void *addr, bool color_output) {
 
 #include <cstdio>
 #include <cstdlib>
+#include <mutex>
 #include <sstream>
 #include <string>
 
 // This function produces a stack backtrace with demangled function & method
-// names.
-static std::string Backtrace(int skip = 1) throw() {
-  void *callstack[128];
-  const int nMaxFrames = sizeof(callstack) / sizeof(callstack[0]);
+// names from return addresses saved with backtrace.
+static std::string Backtrace(void *const *callstack, int nFrames,
+                             bool truncated) throw() {
   char buf[1024];
-  int nFrames = backtrace(callstack, nMaxFrames);
   char **symbols = backtrace_symbols(callstack, nFrames);
 
   std::ostringstream trace_buf;
-  for (int i = skip; i < nFrames - 2; i++) {
+  for (int i = 0; i < nFrames - 2; i++) {
     // printf("%s\n", symbols[i]);
 
     Dl_info info;
@@ -130,7 +129,7 @@ static std::string Backtrace(int skip = 1) throw() {
       char *line = addr2line(info.dli_fname, callstack[i], false);
 
       snprintf(buf, sizeof(buf), "%5d %s + %zd %s\n",
-               i - skip,  // int(2 + sizeof(void*) * 2), callstack[i],
+               i,  // int(2 + sizeof(void*) * 2), callstack[i],
                status == 0 ? demangled
                            : info.dli_sname == 0 ? symbols[i] : info.dli_sname,
                (char *)callstack[i] - (char *)info.dli_saddr, line);
@@ -138,13 +137,13 @@ static std::string Backtrace(int skip = 1) throw() {
       free(demangled);
     } else {
       snprintf(buf, sizeof(buf), "%5d %s\n",
-               i - skip,  // int(2 + sizeof(void*) * 2), callstack[i],
+               i,  // int(2 + sizeof(void*) * 2), callstack[i],
                symbols[i]);
     }
     trace_buf << buf;
   }
   free(symbols);
-  if (nFrames == nMaxFrames) trace_buf << "[truncated]\n";
+  if (truncated) trace_buf << "[truncated]\n";
   return trace_buf.str();
 }
 
@@ -152,6 +151,46 @@ static std::string Backtrace(int skip = 1) throw() {
 
 namespace framework {
 namespace exception {
-void Exception::buildStackTrace() throw() { stackTrace_ = Backtrace(2); }
+
+void Exception::buildStackTrace() throw() {
+  void *callstack[128];
+  const int nMaxFrames = sizeof(callstack) / sizeof(callstack[0]);
+  int nFrames = backtrace(callstack, nMaxFrames);
+  // skip this function, the trace starts at the constructor
+  const int skip = 1;
+  try {
+    if (nFrames > skip) frames_.assign(callstack + skip, callstack + nFrames);
+    // remember if the stack was deeper than what was saved
+    if (nFrames == nMaxFrames) frames_.push_back(nullptr);
+    if (not frames_.empty()) stackTrace_ = std::make_shared<LazyTrace>();
+  } catch (...) {
+    frames_.clear();
+    stackTrace_.reset();
+  }
+}
+
+const std::string &Exception::stackTrace() const throw() {
+  static const std::string none;
+  if (not stackTrace_) return none;
+  try {
+    std::call_once(stackTrace_->filled, [this]() {
+      // addr2line writes into static buffers, so only one trace is
+      // filled at a time
+      static std::mutex backtraceMutex;
+      std::lock_guard<std::mutex> lock(backtraceMutex);
+      bool truncated = frames_.back() == nullptr;
+      try {
+        stackTrace_->trace = Backtrace(
+            frames_.data(), frames_.size() - truncated, truncated);
+      } catch (...) {
+        stackTrace_->trace.clear();
+      }
+    });
+  } catch (...) {
+    // the trace is left empty if the call itself fails
+  }
+  return stackTrace_->trace;
+}
+
 }  // namespace exception
 }  // namespace framework
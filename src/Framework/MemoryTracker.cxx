@@ -0,0 +1,139 @@
+#include "Framework/MemoryTracker.h"
+
+#include <dlfcn.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include "Framework/AllocationCounter.h"
+#include "Framework/EventProcessor.h"
+#include "Framework/Exception/Exception.h"
+
+namespace framework {
+
+namespace {
+
+/// Counts kept by the allocation counter library, null if it isn't loaded
+AllocationCounter *counter{nullptr};
+
+/// Tag of what the calling thread is running, kept by the library
+int *(*currentTag)(){nullptr};
+
+/// @return true if allocations are being counted
+inline bool tracking() {
+  return counter != nullptr and
+         counter->tracking.load(std::memory_order_relaxed);
+}
+
+/// Tags that were current before each processor call on this thread
+thread_local int moduleStack[64];
+
+/// Peak resident set size at the start of each processor call on this thread
+thread_local long moduleStartPeaks[64];
+
+/// Depth of processor calls on this thread
+thread_local int moduleDepth{0};
+
+/// @return the peak resident set size of the process [kB]
+long peakResidentSize() {
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+  return usage.ru_maxrss;
+}
+
+}  // namespace
+
+MemoryTracker &MemoryTracker::getInstance() {
+  static MemoryTracker instance;
+  return instance;
+}
+
+void MemoryTracker::enable(const std::vector<EventProcessor *> &sequence) {
+  // the library replaces operator new, so it has to be preloaded
+  auto getCounter{reinterpret_cast<AllocationCounter *(*)()>(
+      dlsym(RTLD_DEFAULT, "frameworkAllocationCounter"))};
+  currentTag = reinterpret_cast<int *(*)()>(
+      dlsym(RTLD_DEFAULT, "frameworkAllocationTag"));
+  if (getCounter == nullptr or currentTag == nullptr) {
+    EXCEPTION_RAISE("InvalidConfig",
+                    "Memory tracking needs the allocation counter library, "
+                    "run with LD_PRELOAD=libFramework_AllocationCounter.so.");
+  }
+  counter = getCounter();
+  names_ = {"other", "read", "fill", "clear"};
+  for (auto module : sequence) names_.push_back(module->getName());
+  counter->tracking = true;
+}
+
+void MemoryTracker::beforeModule(std::size_t index, const EventProcessor &) {
+  int tag = NumPhases + index;
+  if (moduleDepth >= 64 or tag >= AllocationCounter::MAX_TAGS) tag = Other;
+  long startPeak{0};
+  int previous = push(tag, startPeak);
+  if (moduleDepth < 64) {
+    moduleStack[moduleDepth] = previous;
+    moduleStartPeaks[moduleDepth] = startPeak;
+  }
+  moduleDepth++;
+}
+
+void MemoryTracker::afterModule(std::size_t, const EventProcessor &) {
+  moduleDepth--;
+  if (moduleDepth < 64)
+    pop(moduleStack[moduleDepth], moduleStartPeaks[moduleDepth]);
+}
+
+int MemoryTracker::push(int tag, long &startPeak) {
+  int &current{*currentTag()};
+  int previous{current};
+  startPeak = peakResidentSize();
+  current = tag;
+  return previous;
+}
+
+void MemoryTracker::pop(int previous, long startPeak) {
+  int &current{*currentTag()};
+  long growth = peakResidentSize() - startPeak;
+  if (growth > 0)
+    counter->counts[current].peakGrowth.fetch_add(growth,
+                                                  std::memory_order_relaxed);
+  current = previous;
+}
+
+std::string MemoryTracker::summary(long numEvents) const {
+  std::size_t width{6};
+  for (auto const &name : names_) width = std::max(width, name.size());
+  double perEvent = numEvents > 0 ? 1. / numEvents : 0.;
+
+  std::stringstream table;
+  table << std::left << std::setw(width) << "Module" << std::right
+        << std::setw(14) << "Allocations" << std::setw(12) << "Allocs/evt"
+        << std::setw(14) << "MB allocated" << std::setw(12) << "kB/evt"
+        << std::setw(14) << "Frees" << std::setw(16) << "Peak RSS +MB";
+  table << std::fixed << std::setprecision(2);
+  for (std::size_t i = 0; i < names_.size() and i < AllocationCounter::MAX_TAGS;
+       i++) {
+    const AllocationCounter::Counts &tag{counter->counts[i]};
+    long allocations = tag.allocations.load(), bytes = tag.bytes.load();
+    table << "\n"
+          << std::left << std::setw(width) << names_.at(i) << std::right
+          << std::setw(14) << allocations << std::setw(12)
+          << allocations * perEvent << std::setw(14) << bytes / 1048576.
+          << std::setw(12) << bytes * perEvent / 1024. << std::setw(14)
+          << tag.frees.load() << std::setw(16)
+          << tag.peakGrowth.load() / 1024.;
+  }
+  return table.str();
+}
+
+MemoryTracker::Scope::Scope(Phase phase) {
+  if (not tracking()) return;
+  previous_ = push(phase, startPeak_);
+}
+
+MemoryTracker::Scope::~Scope() {
+  if (previous_ >= 0) pop(previous_, startPeak_);
+}
+
+}  // namespace framework
@@ -0,0 +1,180 @@
+#include "Framework/ModuleTimer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include "Framework/EventProcessor.h"
+#include "Framework/Exception/Exception.h"
+#include "TDirectory.h"
+#include "TTree.h"
+
+namespace framework {
+
+/**
+ * Start times of the calls being timed on this thread
+ *
+ * It is a stack since an on-demand producer is called from inside the
+ * processor that requested its product.
+ */
+static thread_local std::vector<std::chrono::steady_clock::time_point>
+    callStarts;
+
+ModuleTimer::ModuleTimer(const std::vector<EventProcessor *> &sequence)
+    : timings_{std::make_unique<Timing[]>(sequence.size())} {
+  for (auto module : sequence) names_.push_back(module->getName());
+}
+
+void ModuleTimer::beforeModule(std::size_t, const EventProcessor &) {
+  callStarts.push_back(std::chrono::steady_clock::now());
+}
+
+void ModuleTimer::afterModule(std::size_t index, const EventProcessor &) {
+  long ns{std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - callStarts.back())
+              .count()};
+  callStarts.pop_back();
+
+  Timing &timing{timings_[index]};
+  timing.calls.fetch_add(1, std::memory_order_relaxed);
+  timing.total.fetch_add(ns, std::memory_order_relaxed);
+  timing.bins[bin(ns)].fetch_add(1, std::memory_order_relaxed);
+  long max{timing.max.load(std::memory_order_relaxed)};
+  while (ns > max and not timing.max.compare_exchange_weak(
+                          max, ns, std::memory_order_relaxed))
+    ;
+}
+
+void ModuleTimer::addCallbackTime(std::size_t index, Callback callback,
+                                  double seconds) {
+  Timing &timing{timings_[index]};
+  if (callback == Callback::NewRun) {
+    timing.newRunCalls++;
+    timing.newRunTime += seconds;
+  } else {
+    timing.fileOpenCalls++;
+    timing.fileOpenTime += seconds;
+  }
+}
+
+std::string ModuleTimer::summary(long numEvents, double wallSeconds) const {
+  std::size_t width{6};
+  for (auto const &name : names_) width = std::max(width, name.size());
+
+  std::stringstream table;
+  table << "Processed " << numEvents << " events in " << wallSeconds << " s";
+  if (wallSeconds > 0)
+    table << " (" << numEvents / wallSeconds << " events/s)";
+  table << "\n"
+        << std::left << std::setw(width) << "Module" << std::right
+        << std::setw(10) << "Calls" << std::setw(12) << "Total [s]"
+        << std::setw(12) << "Mean [ms]" << std::setw(12) << "p50 [ms]"
+        << std::setw(12) << "p99 [ms]" << std::setw(12) << "Max [ms]"
+        << std::setw(14) << "NewRun [s]" << std::setw(14) << "FileOpen [s]";
+  table << std::fixed;
+  for (std::size_t i = 0; i < names_.size(); i++) {
+    Summary s{summarize(timings_[i])};
+    table << "\n"
+          << std::left << std::setw(width) << names_.at(i) << std::right
+          << std::setw(10) << s.calls << std::setprecision(3)
+          << std::setw(12) << s.total << std::setw(12) << s.mean * 1e3
+          << std::setw(12) << s.p50 * 1e3 << std::setw(12) << s.p99 * 1e3
+          << std::setw(12) << s.max * 1e3 << std::setw(14)
+          << timings_[i].newRunTime << std::setw(14)
+          << timings_[i].fileOpenTime;
+  }
+  return table.str();
+}
+
+void ModuleTimer::writeJson(const std::string &fileName) const {
+  std::ofstream file(fileName);
+  if (not file) {
+    EXCEPTION_RAISE("TimingFile",
+                    "Unable to open '" + fileName + "' to write timing.");
+  }
+  file << "{\n  \"modules\": [";
+  for (std::size_t i = 0; i < names_.size(); i++) {
+    Summary s{summarize(timings_[i])};
+    file << (i > 0 ? "," : "") << "\n    {\"name\": \"" << names_.at(i)
+         << "\", \"calls\": " << s.calls << ", \"total\": " << s.total
+         << ", \"mean\": " << s.mean << ", \"p50\": " << s.p50
+         << ", \"p99\": " << s.p99 << ", \"max\": " << s.max
+         << ", \"newRunCalls\": " << timings_[i].newRunCalls
+         << ", \"newRunTime\": " << timings_[i].newRunTime
+         << ", \"fileOpenCalls\": " << timings_[i].fileOpenCalls
+         << ", \"fileOpenTime\": " << timings_[i].fileOpenTime << "}";
+  }
+  file << "\n  ]\n}\n";
+}
+
+void ModuleTimer::writeTree(TDirectory *dir) const {
+  dir->cd();
+  auto tree{new TTree("ModuleTiming", "Timing of each processor [s]")};
+  std::string name;
+  Summary s;
+  double newRunTime, fileOpenTime;
+  tree->Branch("name", &name);
+  tree->Branch("calls", &s.calls, "calls/L");
+  tree->Branch("total", &s.total, "total/D");
+  tree->Branch("mean", &s.mean, "mean/D");
+  tree->Branch("p50", &s.p50, "p50/D");
+  tree->Branch("p99", &s.p99, "p99/D");
+  tree->Branch("max", &s.max, "max/D");
+  tree->Branch("newRunTime", &newRunTime, "newRunTime/D");
+  tree->Branch("fileOpenTime", &fileOpenTime, "fileOpenTime/D");
+  for (std::size_t i = 0; i < names_.size(); i++) {
+    name = names_.at(i);
+    s = summarize(timings_[i]);
+    newRunTime = timings_[i].newRunTime;
+    fileOpenTime = timings_[i].fileOpenTime;
+    tree->Fill();
+  }
+  // the tree is written with the rest of the histogram file
+  tree->ResetBranchAddresses();
+}
+
+int ModuleTimer::bin(long ns) {
+  if (ns < BINS_PER_OCTAVE) return std::max(ns, 0L);
+  // the highest bit gives the octave and the next three bits the bin in it
+  int octave{63 - __builtin_clzl(ns)};
+  int sub{static_cast<int>((ns >> (octave - 3)) & (BINS_PER_OCTAVE - 1))};
+  return (octave - 2) * BINS_PER_OCTAVE + sub;
+}
+
+double ModuleTimer::binCenter(int bin) {
+  if (bin < BINS_PER_OCTAVE) return bin;
+  int octave{bin / BINS_PER_OCTAVE + 2};
+  int sub{bin % BINS_PER_OCTAVE};
+  double low = static_cast<double>(BINS_PER_OCTAVE + sub) *
+               static_cast<double>(1L << (octave - 3));
+  return low + 0.5 * static_cast<double>(1L << (octave - 3));
+}
+
+ModuleTimer::Summary ModuleTimer::summarize(const Timing &timing) {
+  Summary s{};
+  s.calls = timing.calls.load();
+  s.total = timing.total.load() * 1e-9;
+  s.max = timing.max.load() * 1e-9;
+  if (s.calls == 0) return s;
+  s.mean = s.total / s.calls;
+
+  long cumulative{0};
+  long p50Rank{(s.calls + 1) / 2}, p99Rank{(99 * s.calls + 99) / 100};
+  for (int i = 0; i < NUM_BINS; i++) {
+    long before{cumulative};
+    cumulative += timing.bins[i].load();
+    if (before < p50Rank and cumulative >= p50Rank)
+      s.p50 = binCenter(i) * 1e-9;
+    if (before < p99Rank and cumulative >= p99Rank) {
+      s.p99 = binCenter(i) * 1e-9;
+      break;
+    }
+  }
+  // the bin center may be past the longest call
+  s.p50 = std::min(s.p50, s.max);
+  s.p99 = std::min(s.p99, s.max);
+  return s;
+}
+
+}  // namespace framework
@@ -0,0 +1,206 @@
+#include "Framework/PerfCounters.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include "Framework/EventProcessor.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace framework {
+
+namespace {
+
+/// Values read from the counters
+using Values = std::array<unsigned long, PerfCounters::NUM_COUNTERS>;
+
+/**
+ * One read of the counters of a thread
+ *
+ * When there are more counters than hardware registers, the kernel
+ * multiplexes them and the group only counts while it is running.
+ */
+struct Reading {
+  /// Value of each counter, zero if it isn't open
+  Values values;
+  /// Nanoseconds the group was enabled
+  unsigned long enabled{0};
+  /// Nanoseconds the group was running on the hardware
+  unsigned long running{0};
+};
+
+/**
+ * Group of counters for the calling thread
+ *
+ * The cycle counter leads the group so that all of the counters are
+ * read with one system call.
+ */
+class ThreadCounters {
+ public:
+  /// Open the counters for this thread
+  ThreadCounters() {
+#ifdef __linux__
+    const unsigned long configs[PerfCounters::NUM_COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    for (int i = 0; i < PerfCounters::NUM_COUNTERS; i++) {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = configs[i];
+      attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                         PERF_FORMAT_TOTAL_TIME_RUNNING;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      int fd = syscall(SYS_perf_event_open, &attr, 0, -1,
+                       leader_ < 0 ? -1 : leader_, 0);
+      if (fd < 0) {
+        error_ = errno;
+        // without the leader there is nothing to read
+        if (leader_ < 0) return;
+        continue;
+      }
+      if (leader_ < 0) leader_ = fd;
+      slots_[i] = numOpen_++;
+      fds_.push_back(fd);
+    }
+#else
+    error_ = ENOSYS;
+#endif
+  }
+
+  /// Close the counters
+  ~ThreadCounters() {
+#ifdef __linux__
+    for (int fd : fds_) close(fd);
+#endif
+  }
+
+  /**
+   * Read the counters
+   *
+   * @param[out] reading values of the counters and times of the group
+   * @return false if the counters couldn't be read
+   */
+  bool read(Reading &reading) const {
+    if (leader_ < 0) return false;
+#ifdef __linux__
+    // the group is read as the number of counters, the times enabled and
+    // running, followed by each value
+    unsigned long buffer[PerfCounters::NUM_COUNTERS + 3];
+    if (::read(leader_, buffer, sizeof(buffer)) <
+        static_cast<ssize_t>((numOpen_ + 3) * sizeof(unsigned long)))
+      return false;
+    reading.enabled = buffer[1];
+    reading.running = buffer[2];
+    for (int i = 0; i < PerfCounters::NUM_COUNTERS; i++)
+      reading.values[i] = slots_[i] < 0 ? 0 : buffer[3 + slots_[i]];
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  /// errno from opening the counters, zero if they are open
+  int error() const { return error_; }
+
+ private:
+  /// File descriptor of the group leader, negative if not open
+  int leader_{-1};
+  /// All open file descriptors
+  std::vector<int> fds_;
+  /// Position of each counter in the group, negative if not open
+  std::array<int, PerfCounters::NUM_COUNTERS> slots_{-1, -1, -1, -1};
+  /// Number of counters open
+  int numOpen_{0};
+  /// errno from opening the counters
+  int error_{0};
+};
+
+/// Counters of the calling thread, opened the first time they are needed
+thread_local std::unique_ptr<ThreadCounters> threadCounters;
+
+/// Counter values at the start of the calls being counted on this thread
+thread_local std::vector<Reading> callStarts;
+
+}  // namespace
+
+PerfCounters::PerfCounters(const std::vector<EventProcessor *> &sequence)
+    : counts_{std::make_unique<Counts[]>(sequence.size())} {
+  for (auto module : sequence) names_.push_back(module->getName());
+}
+
+void PerfCounters::beforeModule(std::size_t, const EventProcessor &) {
+  if (not threadCounters) {
+    threadCounters = std::make_unique<ThreadCounters>();
+    if (threadCounters->error()) openError_ = threadCounters->error();
+  }
+  callStarts.emplace_back();
+  // mark the start as unread so the call isn't counted
+  if (not threadCounters->read(callStarts.back()))
+    callStarts.back().values[0] = -1UL;
+}
+
+void PerfCounters::afterModule(std::size_t index, const EventProcessor &) {
+  Reading start{callStarts.back()};
+  callStarts.pop_back();
+  Reading end;
+  if (start.values[0] == -1UL or not threadCounters->read(end)) return;
+
+  Counts &counts{counts_[index]};
+  counts.calls.fetch_add(1, std::memory_order_relaxed);
+
+  // scale up the counts if the group wasn't on the hardware the whole call
+  unsigned long enabled{end.enabled - start.enabled},
+      running{end.running - start.running};
+  double scale{1.};
+  if (running < enabled) {
+    counts.multiplexed.fetch_add(1, std::memory_order_relaxed);
+    scale = running > 0 ? double(enabled) / running : 0.;
+  }
+  for (int i = 0; i < NUM_COUNTERS; i++) {
+    unsigned long count{end.values[i] - start.values[i]};
+    if (scale != 1.) count = static_cast<unsigned long>(count * scale);
+    counts.sums[i].fetch_add(count, std::memory_order_relaxed);
+  }
+}
+
+std::string PerfCounters::summary() const {
+  std::stringstream table;
+  if (openError_) {
+    table << "Some or all hardware counters could not be opened ("
+          << std::strerror(openError_)
+          << "), check /proc/sys/kernel/perf_event_paranoid\n";
+  }
+
+  std::size_t width{6};
+  for (auto const &name : names_) width = std::max(width, name.size());
+  table << std::left << std::setw(width) << "Module" << std::right
+        << std::setw(10) << "Calls" << std::setw(16) << "Cycles"
+        << std::setw(16) << "Instructions" << std::setw(8) << "IPC"
+        << std::setw(16) << "Cache miss/ki" << std::setw(16)
+        << "Branch miss/ki" << std::setw(14) << "Multiplexed";
+  table << std::fixed << std::setprecision(2);
+  for (std::size_t i = 0; i < names_.size(); i++) {
+    const Counts &counts{counts_[i]};
+    double cycles = counts.sums[0].load(), instructions = counts.sums[1].load();
+    double perKilo = instructions > 0 ? 1000. / instructions : 0.;
+    table << "\n"
+          << std::left << std::setw(width) << names_.at(i) << std::right
+          << std::setw(10) << counts.calls.load() << std::setw(16)
+          << counts.sums[0].load() << std::setw(16) << counts.sums[1].load()
+          << std::setw(8) << (cycles > 0 ? instructions / cycles : 0.)
+          << std::setw(16) << counts.sums[2].load() * perKilo << std::setw(16)
+          << counts.sums[3].load() * perKilo << std::setw(14)
+          << counts.multiplexed.load();
+  }
+  return table.str();
+}
+
+}  // namespace framework
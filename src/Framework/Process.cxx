@@ -4,20 +4,81 @@
  */
 
 #include "Framework/Process.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <future>
 #include <iostream>
+#include <limits>
+#include <mutex>
+#include <set>
 #include "Framework/Event.h"
 #include "Framework/EventFile.h"
 #include "Framework/EventProcessor.h"
 #include "Framework/Exception/Exception.h"
 #include "Framework/Logger.h"
+#include "Framework/MemoryTracker.h"
 #include "Framework/NtupleManager.h"
 #include "Framework/PluginFactory.h"
 #include "Framework/RunHeader.h"
+#include "Framework/TraceRecorder.h"
 #include "TFile.h"
 #include "TROOT.h"
 
 namespace framework {
 
+namespace {
+
+/**
+ * Start times of the processor calls being traced on this thread
+ */
+thread_local std::vector<std::chrono::steady_clock::time_point> traceStarts;
+
+/**
+ * Hook recording each processor call in the trace
+ */
+class ModuleTracer : public ModuleHook {
+ public:
+  /// Trace calls made by the input process
+  ModuleTracer(const Process &process) : process_{process} {}
+
+  /// Start the span for the call
+  void beforeModule(std::size_t, const EventProcessor &) final {
+    traceStarts.push_back(std::chrono::steady_clock::now());
+  }
+
+  /// Record the span for the call
+  void afterModule(std::size_t, const EventProcessor &module) final {
+    const ldmx::EventHeader *header{process_.getEventHeader()};
+    TraceRecorder::getInstance().span("module", module.getName(),
+                                      traceStarts.back(),
+                                      header ? header->getEventNumber() : -1);
+    traceStarts.pop_back();
+  }
+
+ private:
+  /// Process making the calls, used for the current event number
+  const Process &process_;
+};
+
+}  // namespace
+
+struct Process::Stream {
+  /// Create a stream with an empty event bus
+  Stream(const std::string &passName) : event(passName) {}
+  /// Event bus for the event on this stream
+  Event event;
+  /// Storage control votes for the event on this stream
+  StorageControl storageController;
+  /// Calls to the processors run on this stream, shared with or cloned
+  /// from the sequence
+  std::vector<ModuleCall> calls;
+};
+
+thread_local Process::Stream *Process::currentStream_{nullptr};
+
 Process::Process(const framework::config::Parameters &configuration)
     : conditions_{*this} {
 
@@ -28,10 +89,23 @@ Process::Process(const framework::config::Parameters &configuration)
   logFileName_ = configuration.getParameter<std::string>("logFileName", "");
 
   maxTries_ = configuration.getParameter<int>("maxTriesPerEvent", 1);
+  // needed before the processors open the histogram file
+  checkpointEvents_ = configuration.getParameter<int>("checkpointEvents", 0);
   eventLimit_ = configuration.getParameter<int>("maxEvents", -1);
   logFrequency_ = configuration.getParameter<int>("logFrequency", -1);
   compressionSetting_ =
       configuration.getParameter<int>("compressionSetting", 9);
+  numStreams_ = configuration.getParameter<int>("numStreams", 1);
+  numThreads_ = configuration.getParameter<int>("numThreads", 1);
+  if (numThreads_ > 1) {
+    // compression of output baskets and unzipping of input baskets
+    // is done in parallel by ROOT with this many threads
+    ROOT::EnableThreadSafety();
+    ROOT::EnableImplicitMT(numThreads_);
+    threadPool_ = std::make_shared<ThreadPool>(numThreads_);
+  }
+  parallelSequence_ =
+      configuration.getParameter<bool>("parallelSequence", false);
   termLevelInt_ = configuration.getParameter<int>("termLogLevel", 2);
   fileLevelInt_ = configuration.getParameter<int>("fileLogLevel", 0);
 
@@ -42,6 +116,13 @@ Process::Process(const framework::config::Parameters &configuration)
   dropKeepRules_ =
       configuration.getParameter<std::vector<std::string>>("keep", {});
 
+  if (numStreams_ > 1 and not inputFiles_.empty()) {
+    // entries of the input tree are read onto a single event bus
+    EXCEPTION_RAISE("InvalidConfig",
+                    "Several streams are only supported when producing "
+                    "events, set numStreams to 1 when reading input files.");
+  }
+
   eventHeader_ = 0;
 
   auto run{configuration.getParameter<int>("run", -1)};
@@ -92,6 +173,68 @@ Process::Process(const framework::config::Parameters &configuration)
     }
     ep->configure(proc);
     sequence_.push_back(ep);
+    sequenceParameters_.push_back(proc);
+    onDemand_.push_back(proc.getParameter<bool>("onDemand", false) and
+                        dynamic_cast<Producer *>(ep));
+    filters_.push_back(proc.getParameter<bool>("isFilter", false));
+  }
+
+  moduleTimingJson_ =
+      configuration.getParameter<std::string>("moduleTimingJson", "");
+  moduleTimingTree_ =
+      configuration.getParameter<bool>("moduleTimingTree", false);
+  if (moduleTimingTree_ and histoFilename_.empty()) {
+    // found now rather than after all the events are processed
+    EXCEPTION_RAISE("InvalidConfig",
+                    "The module timing tree is written to the histogram "
+                    "file, set 'p.histogramFile' or turn off "
+                    "'p.moduleTimingTree'.");
+  }
+  if (configuration.getParameter<bool>("moduleTiming", false) or
+      not moduleTimingJson_.empty() or moduleTimingTree_) {
+    moduleTimer_ = std::make_shared<ModuleTimer>(sequence_);
+    addModuleHook(moduleTimer_);
+  }
+
+  if (configuration.getParameter<bool>("perfCounters", false)) {
+    perfCounters_ = std::make_shared<PerfCounters>(sequence_);
+    addModuleHook(perfCounters_);
+  }
+
+  checkpointFile_ =
+      configuration.getParameter<std::string>("checkpointFile", "");
+  if (checkpointFile_.empty()) {
+    // keep the checkpoint next to what the job writes
+    if (not outputFiles_.empty())
+      checkpointFile_ = outputFiles_.at(0) + ".checkpoint";
+    else if (not histoFilename_.empty())
+      checkpointFile_ = histoFilename_ + ".checkpoint";
+    else
+      checkpointFile_ = passname_ + ".checkpoint";
+  }
+
+  auto slowEvents{configuration.getParameter<int>("slowEvents", 0)};
+  replayFile_ = configuration.getParameter<std::string>("replayFile", "");
+  if (slowEvents > 0) {
+    slowEvents_ = std::make_shared<SlowEvents>(slowEvents, sequence_);
+  } else if (not replayFile_.empty()) {
+    EXCEPTION_RAISE("InvalidConfig",
+                    "A replay file needs slowEvents to be more than zero.");
+  }
+
+  memoryTracking_ = configuration.getParameter<bool>("memoryTracking", false);
+  if (memoryTracking_) {
+    MemoryTracker::getInstance().enable(sequence_);
+    // the tracker lives for the whole program, don't let the hook delete it
+    addModuleHook(std::shared_ptr<ModuleHook>(&MemoryTracker::getInstance(),
+                                              [](ModuleHook *) {}));
+  }
+
+  traceFile_ = configuration.getParameter<std::string>("traceFile", "");
+  if (not traceFile_.empty()) {
+    TraceRecorder::getInstance().enable(
+        configuration.getParameter<int>("traceBufferSize", 1000000));
+    addModuleHook(std::make_shared<ModuleTracer>(*this));
   }
 
   auto conditionsObjectProviders{
@@ -129,14 +272,92 @@ void Process::run() {
   // Counter to keep track of the number of events that have been
   // procesed
   auto n_events_processed{0};
+  auto startTime{std::chrono::steady_clock::now()};
+
+  Checkpoint resumePoint;
+  if (resume_) {
+    resumePoint = Checkpoint::read(checkpointFile_);
+    if ((resumePoint.inputFileIndex >= 0) == inputFiles_.empty()) {
+      EXCEPTION_RAISE("Checkpoint",
+                      "Checkpoint '" + checkpointFile_ +
+                          "' is from a job with" +
+                          (inputFiles_.empty() ? "" : "out") +
+                          " input files.");
+    }
+    n_events_processed = resumePoint.eventsProcessed;
+    checkpoint_ = resumePoint;
+    // the files from before the checkpoint are kept as they are
+    for (auto &outputFile : outputFiles_)
+      outputFile = Checkpoint::resumedFileName(outputFile, n_events_processed);
+    if (not histoFilename_.empty())
+      histoFilename_ = Checkpoint::resumedFileName(histoFilename_,
+                                                   n_events_processed);
+    ldmx_log(info) << "Resuming after " << n_events_processed
+                   << " events from checkpoint '" << checkpointFile_ << "'";
+  }
 
   // event bus for this process
   Event theEvent(passname_);
+  for (auto const &rule :
+       config_.getParameter<std::vector<framework::config::Parameters>>(
+           "branchRules", {})) {
+    theEvent.addBranchRule(rule.getParameter<std::string>("namePattern"),
+                           rule.getParameter<int>("basketSize"),
+                           rule.getParameter<int>("splitLevel"));
+  }
 
   // Start by notifying everyone that modules processing is beginning
   conditions_.onProcessStart();
   for (auto module : sequence_) module->onProcessStart();
 
+  // the products are declared by now, so the on-demand producers can be
+  // checked and the dependencies can be found
+  for (std::size_t j = 0; j < sequence_.size(); j++) {
+    if (not onDemand_.at(j)) continue;
+    EventProcessor *producer{sequence_.at(j)};
+    if (producer->getProducedProducts().empty()) {
+      ldmx_log(warn) << "On-demand producer '" << producer->getName()
+                     << "' did not declare any products, it will be run "
+                     << "for every event.";
+      onDemand_.at(j) = false;
+      continue;
+    }
+    bool consumed{false};
+    for (auto module : sequence_)
+      for (auto const &tag : module->getConsumedProducts())
+        for (auto const &product : producer->getProducedProducts())
+          consumed = consumed or (tag.name() == product.name() and
+                                  (tag.passname().empty() or
+                                   tag.passname() == passname_));
+    if (not consumed) {
+      ldmx_log(info) << "No processor declared that it reads the products of '"
+                     << producer->getName() << "', it will only be run if "
+                     << "they are requested by name or kept in the output.";
+    }
+  }
+  calls_.clear();
+  for (std::size_t j = 0; j < sequence_.size(); j++)
+    calls_.push_back(makeModuleCall(sequence_.at(j), j));
+  setupOnDemand(theEvent, calls_);
+  outputEvent_ = &theEvent;
+  configureFilters();
+
+  if (parallelSequence_) {
+    if (numThreads_ < 2) {
+      ldmx_log(warn) << "Processors can only run in parallel with more than "
+                     << "one thread, they will be run in order.";
+    } else {
+      sequenceGraph_ = std::make_shared<SequenceGraph>(sequence_, passname_);
+      if (sequenceGraph_->isParallel()) {
+        theEvent.setConcurrentAccess(true);
+      } else {
+        ldmx_log(info) << "Every processor depends on the one before it, "
+                       << "they will be run in order.";
+        sequenceGraph_.reset();
+      }
+    }
+  }
+
   // If we have no input files, but do have an event number, run for
   // that number of events and generate an output file.
   if (inputFiles_.empty() && eventLimit_ > 0) {
@@ -154,7 +375,9 @@ void Process::run() {
     // requires setting the parameters isOutputFile and isSingleOutput to true.
     EventFile outFile(config_, outputFileName, nullptr, true, true, false); 
 
-    for (auto module : sequence_) module->onFileOpen(outFile);
+    callEachModule(
+        ModuleTimer::Callback::FileOpen,
+        [&](EventProcessor *module) { module->onFileOpen(outFile); });
 
     outFile.setupEvent(&theEvent);
 
@@ -164,18 +387,16 @@ void Process::run() {
     runHeader.setRunStart(std::time(nullptr));  // set run starting
     runHeader_ = &runHeader;            // give handle to run header to process
     outFile.writeRunHeader(runHeader);  // add run header to file
+    newRun(runHeader);
 
-    for (auto module : sequence_)
-      if (dynamic_cast<Producer *>(module))
-        dynamic_cast<Producer *>(module)->beforeNewRun(runHeader);
-
-    // now run header has been modified by Producers, so it is valid to read
-    // from
-    conditions_.onNewRun(runHeader);
-    for (auto module : sequence_) module->onNewRun(runHeader);
+    // with several streams, all of the events are processed here
+    //  so the single-stream loop below is skipped
+    if (numStreams_ > 1)
+      n_events_processed =
+          processStreams(theEvent, outFile, n_events_processed);
 
     int numTries = 0;  // number of tries for the current event number
-    while (n_events_processed < eventLimit_) {
+    while (numStreams_ <= 1 and n_events_processed < eventLimit_) {
       ldmx::EventHeader &eh = theEvent.getEventHeader();
       eh.setRun(runForGeneration_);
       eh.setEventNumber(n_events_processed + 1);
@@ -198,19 +419,7 @@ void Process::run() {
                        << t.AsString("lc") << ")";
       }
 
-      bool eventAborted = false;
-      for (auto module : sequence_) {
-        try {
-          if (dynamic_cast<Producer *>(module)) {
-            (dynamic_cast<Producer *>(module))->produce(theEvent);
-          } else if (dynamic_cast<Analyzer *>(module)) {
-            (dynamic_cast<Analyzer *>(module))->analyze(theEvent);
-          }
-        } catch (AbortEventException &) {
-          eventAborted = true;
-          break;
-        }
-      }
+      bool eventAborted = processEvent(theEvent, calls_);
 
       outFile.nextEvent(
           eventAborted
@@ -226,6 +435,16 @@ void Process::run() {
 
       NtupleManager::getInstance().clear();
       theEvent.Clear();
+
+      if (finishRequested_ or
+          (numTries == 0 and checkpointDue(n_events_processed))) {
+        saveCheckpoint(n_events_processed, nullptr, &outFile);
+        if (finishRequested_) {
+          ldmx_log(warn) << "Processing interrupted after "
+                         << n_events_processed << " events";
+          break;
+        }
+      }
     }
 
     for (auto module : sequence_) module->onFileClose(outFile);
@@ -252,12 +471,34 @@ void Process::run() {
     // next, loop through the files
     int ifile = 0;
     int wasRun = -1;
-    for (auto infilename : inputFiles_) {
+    for (std::size_t inputIndex = 0; inputIndex < inputFiles_.size();
+         inputIndex++) {
+      const std::string &infilename{inputFiles_.at(inputIndex)};
+      if (resume_ and int(inputIndex) < resumePoint.inputFileIndex) {
+        // this file was finished before the checkpoint,
+        //  its output file too if there is one per input file
+        if (not outputFiles_.empty() and not singleOutput) ifile++;
+        continue;
+      }
+      bool resumeInFile{resume_ and
+                        int(inputIndex) == resumePoint.inputFileIndex};
+      if (resumeInFile and infilename != resumePoint.inputFile) {
+        EXCEPTION_RAISE("Checkpoint",
+                        "Input file " + std::to_string(inputIndex) + " is '" +
+                            infilename + "' but the checkpoint was taken in '" +
+                            resumePoint.inputFile + "'.");
+      }
+
       EventFile inFile(config_, infilename);
+      currentInput_ = &inFile;
+      checkpoint_.inputFileIndex = inputIndex;
+      checkpoint_.inputFile = infilename;
 
       ldmx_log(info) << "Opening file " << infilename;
 
-      for (auto module : sequence_) module->onFileOpen(inFile);
+      callEachModule(
+          ModuleTimer::Callback::FileOpen,
+          [&](EventProcessor *module) { module->onFileOpen(inFile); });
 
       // configure event file that will be iterated over
       EventFile *masterFile;
@@ -281,6 +522,10 @@ void Process::run() {
 
           for (auto rule : dropKeepRules_) outFile->addDrop(rule);
 
+          for (auto module : sequence_)
+            for (auto const &tag : module->getConsumedProducts())
+              outFile->addConsumed(tag);
+
         } else {
           // all other input files
           outFile->updateParent(&inFile);
@@ -294,11 +539,20 @@ void Process::run() {
         masterFile = &inFile;
       }
 
+      // continue with the first event that wasn't processed
+      if (resumeInFile) inFile.seekEntry(resumePoint.nextEntry);
+
       bool eventAborted = false;
       while (
           masterFile->nextEvent(eventAborted ? false
                                              : m_storageController.keepEvent() /*ignore storage controller if event aborted*/) &&
           (eventLimit_ < 0 || (n_events_processed) < eventLimit_)) {
+        // the last event processed has been filled by now
+        if (finishRequested_ or checkpointDue(n_events_processed)) {
+          saveCheckpoint(n_events_processed, &inFile, outFile);
+          if (finishRequested_) break;
+        }
+
         // clean up for storage control calculation
         m_storageController.resetEventState();
 
@@ -308,22 +562,21 @@ void Process::run() {
         // notify for new run if necessary
         if (theEvent.getEventHeader().getRun() != wasRun) {
           wasRun = theEvent.getEventHeader().getRun();
-          try {
-            auto runHeader = masterFile->getRunHeader(wasRun);
+          // looked up without throwing, so errors from the processors'
+          // callbacks aren't mistaken for a missing run header
+          ldmx::RunHeader *foundRunHeader{masterFile->findRunHeader(wasRun)};
+          if (foundRunHeader) {
+            auto runHeader = *foundRunHeader;
             runHeader_ = &runHeader;  // save current run header for later
             ldmx_log(info) << "Got new run header from '"
                            << masterFile->getFileName() << "' ...\n"
                            << runHeader;
-            for (auto module : sequence_)
-              if (dynamic_cast<Producer *>(module))
-                dynamic_cast<Producer *>(module)->beforeNewRun(runHeader);
-            // now run header has been modified by Producers, so it is valid to
-            // read from
-            conditions_.onNewRun(runHeader);
-            for (auto module : sequence_) module->onNewRun(runHeader);
-          } catch (const framework::exception::Exception &) {
+            newRun(runHeader);
+          } else {
             ldmx_log(warn) << "Run header for run " << wasRun
                            << " was not found!";
+            // the conditions of the last run may not be valid for this one
+            conditions_.newEpoch();
           }
         }
 
@@ -336,19 +589,7 @@ void Process::run() {
                          << t.AsString("lc") << ")";
         }
 
-        eventAborted = false;
-        for (auto module : sequence_) {
-          try {
-            if (dynamic_cast<Producer *>(module)) {
-              (dynamic_cast<Producer *>(module))->produce(theEvent);
-            } else if (dynamic_cast<Analyzer *>(module)) {
-              (dynamic_cast<Analyzer *>(module))->analyze(theEvent);
-            }
-          } catch (AbortEventException &) {
-            eventAborted = true;
-            break;
-          }
-        }
+        eventAborted = processEvent(theEvent, calls_);
 
         if (not eventAborted) NtupleManager::getInstance().fill();
         NtupleManager::getInstance().clear();
@@ -360,8 +601,9 @@ void Process::run() {
         ldmx_log(info) << "Reached event limit of " << eventLimit_ << " events";
       }
 
-      if (eventLimit_ == 0 && n_events_processed > eventLimit_) {
-        ldmx_log(warn) << "Processing interrupted";
+      if (finishRequested_) {
+        ldmx_log(warn) << "Processing interrupted after "
+                       << n_events_processed << " events";
       }
 
       ldmx_log(info) << "Closing file " << infilename;
@@ -369,6 +611,7 @@ void Process::run() {
       for (auto module : sequence_) module->onFileClose(inFile);
 
       inFile.close();
+      currentInput_ = nullptr;
 
       // Reset the event in case of multiple input files
       theEvent.onEndOfFile();
@@ -379,6 +622,7 @@ void Process::run() {
         outFile = nullptr;
       }
 
+      if (finishRequested_) break;
     }  // loop through input files
 
     if (outFile) {
@@ -391,11 +635,56 @@ void Process::run() {
 
   }  // are there input files? if-else tree
 
+  ldmx_log(info) << "Event bus high-water mark: "
+                 << theEvent.getBusHighWaterMark() << " bytes";
+
+  if (not inputFiles_.empty()) {
+    ldmx_log(info) << "Waited " << theEvent.getInputStallTime()
+                   << " s for input to be read over " << n_events_processed
+                   << " events";
+  }
+
+  if (moduleTimer_) {
+    ldmx_log(info) << "Module timing\n"
+                   << moduleTimer_->summary(
+                          n_events_processed,
+                          std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - startTime)
+                              .count());
+    if (not moduleTimingJson_.empty())
+      moduleTimer_->writeJson(moduleTimingJson_);
+    if (moduleTimingTree_) moduleTimer_->writeTree(openHistoFile());
+  }
+
+  if (perfCounters_) {
+    ldmx_log(info) << "Hardware counters\n" << perfCounters_->summary();
+  }
+
+  if (slowEvents_) {
+    ldmx_log(info) << slowEvents_->summary();
+    if (not replayFile_.empty()) writeReplayFile();
+  }
+
+  if (memoryTracking_) {
+    ldmx_log(info) << "Heap allocations\n"
+                   << MemoryTracker::getInstance().summary(n_events_processed);
+  }
+
+  ldmx_log(info) << "Conditions cache\n" << conditions_.summary();
+
   // close up histogram file if anything was put into it
   if (histoTFile_) {
+    std::string workingName{histoTFile_->GetName()};
     histoTFile_->Write();
     delete histoTFile_;
     histoTFile_ = 0;
+    // with checkpoints, the complete file replaces the last snapshot
+    if (workingName != histoFilename_ and
+        std::rename(workingName.c_str(), histoFilename_.c_str()) != 0) {
+      EXCEPTION_RAISE("HistogramFile", "Unable to move histogram file '" +
+                                           workingName + "' to '" +
+                                           histoFilename_ + "'.");
+    }
   }
 
   // finally, notify everyone that we are stopping
@@ -403,16 +692,474 @@ void Process::run() {
     module->onProcessEnd();
   }
 
+  if (not traceFile_.empty()) {
+    TraceRecorder::getInstance().write(traceFile_);
+    ldmx_log(info) << "Wrote timeline of processing to " << traceFile_;
+  }
+
   // we're done so let's close up the logging
   logging::close();
 }
 
+int Process::processStreams(Event &writer, EventFile &outFile,
+                            int eventsProcessed) {
+  auto theLog_{logging::makeLogger("Process")};
+
+  // there is one set of ntuple variables, processors on other streams
+  //  would set them while the event being committed is filled
+  if (not NtupleManager::getInstance().empty()) {
+    EXCEPTION_RAISE("InvalidConfig",
+                    "Ntuples can't be filled with more than one stream, "
+                    "their rows would mix variables of different events. "
+                    "Set numStreams to 1.");
+  }
+
+  // processors that only see one event at a time are guarded by a lock
+  std::vector<std::mutex> moduleLocks(sequence_.size());
+
+  // make the streams, copying Stream processors after the first stream
+  std::vector<std::unique_ptr<Stream>> streams;
+  std::vector<EventProcessor *> clones;
+  std::deque<Stream *> idle;
+  for (int i = 0; i < numStreams_; i++) {
+    streams.push_back(std::make_unique<Stream>(passname_));
+    Stream &stream{*streams.back()};
+    if (sequenceGraph_) stream.event.setConcurrentAccess(true);
+    stream.storageController = m_storageController;
+    for (std::size_t j = 0; j < sequence_.size(); j++) {
+      EventProcessor *module{sequence_.at(j)};
+      if (i > 0 and
+          module->getConcurrency() == EventProcessor::Concurrency::Stream) {
+        auto proc{sequenceParameters_.at(j)};
+        module = PluginFactory::getInstance().createEventProcessor(
+            proc.getParameter<std::string>("className"),
+            proc.getParameter<std::string>("instanceName"), *this);
+        module->configure(proc);
+        module->onProcessStart();
+        module->onFileOpen(outFile);
+        if (runHeader_) module->onNewRun(*runHeader_);
+        clones.push_back(module);
+      }
+      stream.calls.push_back(makeModuleCall(module, j, &moduleLocks.at(j)));
+    }
+    setupOnDemand(stream.event, stream.calls);
+    idle.push_back(&stream);
+  }
+
+  // run the sequence for the event on a stream, returns true if aborted
+  auto process = [this](Stream &stream) {
+    currentStream_ = &stream;
+    stream.storageController.resetEventState();
+    bool aborted{false};
+    try {
+      aborted = processEvent(stream.event, stream.calls);
+    } catch (...) {
+      currentStream_ = nullptr;
+      throw;
+    }
+    currentStream_ = nullptr;
+    return aborted;
+  };
+
+  struct InFlight {
+    Stream *stream;
+    int eventNumber;
+    int tries;
+    std::future<bool> aborted;
+  };
+  std::deque<InFlight> inFlight;
+
+  auto submit = [&](Stream &stream, int eventNumber, int tries) {
+    ldmx::EventHeader &eh = stream.event.getEventHeader();
+    eh.setRun(runForGeneration_);
+    eh.setEventNumber(eventNumber);
+    eh.setTimestamp(TTimeStamp());
+    return InFlight{&stream, eventNumber, tries,
+                    threadPool_->submit([&process, &stream]() {
+                      return process(stream);
+                    })};
+  };
+
+  int n_events_processed{eventsProcessed};
+  int nextEventNumber{eventsProcessed + 1};
+  try {
+    while (n_events_processed < eventLimit_) {
+      // keep all idle streams busy
+      while (not idle.empty() and nextEventNumber <= eventLimit_ and
+             not finishRequested_) {
+        inFlight.push_back(submit(*idle.front(), nextEventNumber++, 1));
+        idle.pop_front();
+      }
+
+      // once finishing is requested, the events in flight are finished
+      if (inFlight.empty()) {
+        saveCheckpoint(n_events_processed, nullptr, &outFile);
+        ldmx_log(warn) << "Processing interrupted after "
+                       << n_events_processed << " events";
+        break;
+      }
+
+      // wait for the oldest event so they are written in order
+      InFlight oldest{std::move(inFlight.front())};
+      inFlight.pop_front();
+      bool eventAborted{oldest.aborted.get()};
+      Stream &stream{*oldest.stream};
+
+      if (eventAborted and oldest.tries < maxTries_) {
+        // try again before any later event is written
+        stream.event.Clear();
+        inFlight.push_front(
+            submit(stream, oldest.eventNumber, oldest.tries + 1));
+        continue;
+      }
+
+      if (getLogFrequency() > 0 and
+          (oldest.eventNumber % getLogFrequency() == 0)) {
+        TTimeStamp t;
+        ldmx_log(info) << "Processing " << n_events_processed + 1 << " Run "
+                       << stream.event.getEventHeader().getRun() << " Event "
+                       << oldest.eventNumber << "  (" << t.AsString("lc")
+                       << ")";
+      }
+
+      // move the products onto the event bus attached to the output file
+      writer.getEventHeader() = stream.event.getEventHeader();
+      eventHeader_ = writer.getEventHeaderPtr();
+      if (not eventAborted) writer.takeProducts(stream.event);
+      outFile.nextEvent(eventAborted ? false
+                                     : stream.storageController.keepEvent());
+
+      n_events_processed++;
+      stream.event.Clear();
+      idle.push_back(&stream);
+
+      // only events up to this one have been written
+      if (checkpointDue(n_events_processed))
+        saveCheckpoint(n_events_processed, nullptr, &outFile);
+    }
+  } catch (...) {
+    // the streams can't be cleaned up while events are still running
+    for (auto &running : inFlight) running.aborted.wait();
+    for (auto module : clones) delete module;
+    throw;
+  }
+
+  for (auto module : clones) {
+    module->onFileClose(outFile);
+    module->onProcessEnd();
+    delete module;
+  }
+
+  return n_events_processed;
+}
+
+bool Process::processEvent(Event &event, const std::vector<ModuleCall> &calls) {
+  TraceRecorder::Scope trace("event", "Event",
+                             event.getEventHeader().getEventNumber());
+  Stream *stream{currentStream_};
+  StorageControl &storageController{getStorageController()};
+  // once every filter has voted to drop the event, only the processors
+  // that don't just feed the output file are run
+  std::atomic<int> filtersLeft{numFilters_};
+  std::atomic<bool> dropped{false};
+  auto runScheduled = [&](std::size_t j) {
+    // on-demand producers are run by the processors that need them
+    if (onDemand_.at(j)) return;
+    if (dropped and not neededWhenDropped_.at(j)) return;
+    // processors run on other threads still belong to this stream
+    Stream *previous{currentStream_};
+    currentStream_ = stream;
+    try {
+      calls.at(j).run(event);
+    } catch (...) {
+      currentStream_ = previous;
+      throw;
+    }
+    currentStream_ = previous;
+    if (filters_.at(j) and --filtersLeft == 0 and
+        not storageController.keepEvent())
+      dropped = true;
+  };
+
+  auto start{std::chrono::steady_clock::now()};
+  bool aborted{false};
+  try {
+    if (sequenceGraph_) {
+      aborted = sequenceGraph_->run(*threadPool_, runScheduled);
+    } else {
+      for (std::size_t j = 0; j < calls.size(); j++) runScheduled(j);
+    }
+
+    // on-demand producers whose products are kept have to run
+    // even if nothing requested them
+    std::size_t index{0};
+    for (std::size_t j = 0; j < calls.size() and not aborted and not dropped;
+         j++) {
+      if (not onDemand_.at(j)) continue;
+      for (auto const &product : calls.at(j).module->getProducedProducts()) {
+        if (outputEvent_ and outputEvent_->isPersisted(product.name())) {
+          event.runOnDemand(index);
+          break;
+        }
+      }
+      index++;
+    }
+  } catch (AbortEventException &) {
+    aborted = true;
+  }
+
+  if (slowEvents_) {
+    double seconds{std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count()};
+    if (slowEvents_->isSlow(slowEvents_->eventIndex(), seconds))
+      slowEvents_->addEventTime(seconds, eventSource(event));
+  }
+  return aborted;
+}
+
+void Process::configureFilters() {
+  numFilters_ = 0;
+  neededWhenDropped_.assign(sequence_.size(), true);
+  if (std::find(filters_.begin(), filters_.end(), true) == filters_.end())
+    return;
+
+  // any processor whose hints are counted by a skim rule could still keep
+  //  the event, so it is a filter too and the event is only dropped once
+  //  all of them have run
+  std::vector<bool> voters{filters_};
+  for (std::size_t j = 0; j < sequence_.size(); j++) {
+    if (m_storageController.canVote(sequence_.at(j)->getName()))
+      voters.at(j) = true;
+    // on-demand producers may run after the decision, nothing is skipped
+    if (voters.at(j) and onDemand_.at(j)) return;
+  }
+  filters_ = voters;
+  for (std::size_t j = 0; j < sequence_.size(); j++)
+    if (filters_.at(j)) numFilters_++;
+
+  // go backwards through the sequence, collecting the products
+  // that the processors which still run will read
+  std::set<std::string> needed;
+  bool needAll{false};
+  for (std::size_t j = sequence_.size(); j-- > 0;) {
+    EventProcessor *module{sequence_.at(j)};
+    bool isNeeded{needAll or dynamic_cast<Analyzer *>(module) != nullptr};
+    for (auto const &product : module->getProducedProducts())
+      isNeeded = isNeeded or needed.count(product.name()) > 0;
+    neededWhenDropped_.at(j) = isNeeded;
+    if (not isNeeded) continue;
+    if (module->getConsumedProducts().empty()) needAll = true;
+    for (auto const &tag : module->getConsumedProducts())
+      needed.insert(tag.name());
+  }
+}
+
+Process::ModuleCall Process::makeModuleCall(EventProcessor *module,
+                                            std::size_t index,
+                                            std::mutex *lock) const {
+  ModuleCall call{module, {}};
+  if (auto producer = dynamic_cast<Producer *>(module)) {
+    call.run = [producer](Event &event) { producer->produce(event); };
+  } else if (auto analyzer = dynamic_cast<Analyzer *>(module)) {
+    call.run = [analyzer](Event &event) { analyzer->analyze(event); };
+  } else {
+    call.run = [](Event &) {};
+  }
+
+  // timed inside the hooks so they don't count their own overhead
+  if (slowEvents_) {
+    call.run = [this, index, inner{std::move(call.run)}](Event &event) {
+      auto start{std::chrono::steady_clock::now()};
+      inner(event);
+      double seconds{std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count()};
+      if (slowEvents_->isSlow(index, seconds))
+        slowEvents_->addModuleTime(index, seconds, eventSource(event));
+    };
+  }
+
+  for (auto const &hook : moduleHooks_) {
+    call.run = [hook, index, module, inner{std::move(call.run)}](Event &event) {
+      hook->beforeModule(index, *module);
+      try {
+        inner(event);
+      } catch (...) {
+        hook->afterModule(index, *module);
+        throw;
+      }
+      hook->afterModule(index, *module);
+    };
+  }
+
+  // the lock is outside the hooks so they don't count time spent waiting
+  if (lock and module->getConcurrency() == EventProcessor::Concurrency::One) {
+    call.run = [lock, inner{std::move(call.run)}](Event &event) {
+      std::lock_guard<std::mutex> guard(*lock);
+      inner(event);
+    };
+  }
+  return call;
+}
+
+void Process::newRun(ldmx::RunHeader &runHeader) {
+  std::string seedKey{"RandomNumberMasterSeed[" + passname_ + "]"};
+  // a resumed job keeps the seeds of the run it stopped in
+  if (resume_ and checkpoint_.hasMasterSeed and
+      checkpoint_.run == runHeader.getRunNumber())
+    runHeader.setIntParameter(seedKey, checkpoint_.masterSeed);
+
+  for (auto module : sequence_)
+    if (dynamic_cast<Producer *>(module))
+      dynamic_cast<Producer *>(module)->beforeNewRun(runHeader);
+
+  // now run header has been modified by Producers, so it is valid to read
+  // from
+  if (TraceRecorder::getInstance().isEnabled())
+    TraceRecorder::getInstance().instant(
+        "run", "Run " + std::to_string(runHeader.getRunNumber()));
+  conditions_.onNewRun(runHeader);
+  callEachModule(ModuleTimer::Callback::NewRun, [&](EventProcessor *module) {
+    module->onNewRun(runHeader);
+  });
+
+  auto seed{runHeader.getIntParameters().find(seedKey)};
+  checkpoint_.hasMasterSeed = seed != runHeader.getIntParameters().end();
+  if (checkpoint_.hasMasterSeed) {
+    checkpoint_.run = runHeader.getRunNumber();
+    checkpoint_.masterSeed = seed->second;
+  }
+}
+
+void Process::saveCheckpoint(int eventsProcessed, EventFile *input,
+                             EventFile *output) {
+  auto theLog_{logging::makeLogger("Process")};
+  checkpoint_.eventsProcessed = eventsProcessed;
+  checkpoint_.nextEntry = input ? input->getEntry() : -1;
+  checkpoint_.outputEntries = output ? output->saveProgress() : 0;
+  if (histoTFile_) {
+    // the snapshot is copied to a temporary file and then renamed, so
+    //  the histogram file on disk is always complete
+    histoTFile_->Write(nullptr, TObject::kOverwrite);
+    std::string tmpName{histoFilename_ + ".tmp"};
+    if (not histoTFile_->Cp(tmpName.c_str(), false) or
+        std::rename(tmpName.c_str(), histoFilename_.c_str()) != 0) {
+      EXCEPTION_RAISE("Checkpoint", "Unable to save histograms to '" +
+                                        histoFilename_ + "'.");
+    }
+  }
+  checkpoint_.write(checkpointFile_);
+  ldmx_log(info) << "Wrote checkpoint after " << eventsProcessed
+                 << " events to " << checkpointFile_;
+}
+
+SlowEvents::Source Process::eventSource(Event &event) const {
+  SlowEvents::Source source;
+  source.run = event.getEventHeader().getRun();
+  source.event = event.getEventHeader().getEventNumber();
+  if (currentInput_) {
+    source.file = currentInput_->getFileName();
+    source.entry = currentInput_->getEntry();
+  }
+  return source;
+}
+
+void Process::writeReplayFile() {
+  auto theLog_{logging::makeLogger("Process")};
+  auto inputEntries{slowEvents_->inputEntries()};
+  if (inputEntries.empty()) {
+    ldmx_log(warn) << "None of the slow events were read from an input file, "
+                   << "so there is nothing to write to '" << replayFile_
+                   << "'. Events made by this job are reproduced by "
+                   << "rerunning with the same seeds.";
+    return;
+  }
+
+  // the output file copies the input events like a normal job,
+  // only reading the entries that were slow
+  Event replayEvent(passname_);
+  std::unique_ptr<EventFile> replayFile;
+  std::size_t numEvents{0};
+  for (auto const &[fileName, entries] : inputEntries) {
+    EventFile inFile(config_, fileName);
+    if (replayFile) {
+      replayFile->updateParent(&inFile);
+    } else {
+      replayFile = std::make_unique<EventFile>(config_, replayFile_, &inFile,
+                                               true);
+      replayFile->setupEvent(&replayEvent);
+    }
+    for (auto entry : entries) {
+      inFile.seekEntry(entry);
+      if (replayFile->nextEvent()) numEvents++;
+    }
+    // going past the end fills the last event read
+    inFile.seekEntry(std::numeric_limits<Long64_t>::max());
+    replayFile->nextEvent();
+    inFile.close();
+    replayEvent.onEndOfFile();
+  }
+  replayFile->close();
+  ldmx_log(info) << "Copied " << numEvents << " slow events to "
+                 << replayFile_;
+}
+
+void Process::callEachModule(
+    ModuleTimer::Callback callback,
+    const std::function<void(EventProcessor *)> &call) {
+  for (std::size_t j = 0; j < sequence_.size(); j++) {
+    if (not moduleTimer_) {
+      call(sequence_.at(j));
+      continue;
+    }
+    auto start{std::chrono::steady_clock::now()};
+    call(sequence_.at(j));
+    moduleTimer_->addCallbackTime(
+        j, callback,
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+            .count());
+  }
+}
+
+void Process::setupOnDemand(Event &event,
+                            const std::vector<ModuleCall> &calls) {
+  for (std::size_t j = 0; j < calls.size(); j++) {
+    if (not onDemand_.at(j)) continue;
+    const ModuleCall &call{calls.at(j)};
+    std::vector<std::string> products;
+    for (auto const &product : call.module->getProducedProducts())
+      products.push_back(product.name());
+    event.addOnDemand(products, [&call, &event]() { call.run(event); });
+  }
+}
+
+const ldmx::EventHeader *Process::getEventHeader() const {
+  if (currentStream_) return currentStream_->event.getEventHeaderPtr();
+  return eventHeader_;
+}
+
+StorageControl &Process::getStorageController() {
+  if (currentStream_) return currentStream_->storageController;
+  return m_storageController;
+}
+
 int Process::getRunNumber() const {
-  return (eventHeader_) ? (eventHeader_->getRun()) : (runForGeneration_);
+  const ldmx::EventHeader *eventHeader{getEventHeader()};
+  return (eventHeader) ? (eventHeader->getRun()) : (runForGeneration_);
 }
 
 TDirectory *Process::makeHistoDirectory(const std::string &dirName) {
   auto owner{openHistoFile()};
+  // only copies of a processor made for other streams ask twice,
+  //  they would fill the same histograms at the same time
+  if (owner->GetDirectory(dirName.c_str())) {
+    EXCEPTION_RAISE("HistoDirectoryExists",
+                    "The histogram directory '" + dirName +
+                        "' has already been made. Processors with "
+                        "Concurrency::Stream are copied for each stream "
+                        "and can't book histograms.");
+  }
   TDirectory *child = owner->mkdir((char *)dirName.c_str());
   if (child) child->cd();
   return child;
@@ -429,7 +1176,11 @@ TDirectory *Process::openHistoFile() {
                     "name in the python configuration with 'p.histogramFile = "
                     "\"myHistFile.root\"' where p is the Process object.");
   } else if (histoTFile_ == nullptr) {
-    histoTFile_ = new TFile(histoFilename_.c_str(), "RECREATE");
+    // with checkpoints, histograms are filled in a working file and the
+    //  histogram file only ever holds a complete snapshot or the final file
+    std::string fileName{histoFilename_};
+    if (checkpointEvents_ > 0) fileName += ".part";
+    histoTFile_ = new TFile(fileName.c_str(), "RECREATE");
     owner = histoTFile_;
   } else
     owner = histoTFile_;
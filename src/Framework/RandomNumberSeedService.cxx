@@ -45,15 +45,30 @@ RandomNumberSeedService::RandomNumberSeedService(
 }
 
 void RandomNumberSeedService::onNewRun(ldmx::RunHeader& rh) {
-  if (seedMode_ == SEED_RUN) {
+  std::string key = "RandomNumberMasterSeed[" + process().getPassName() + "]";
+  auto saved = rh.getIntParameters().find(key);
+  if (process().isResuming() and saved != rh.getIntParameters().end()) {
+    // the Process put the master seed from its checkpoint into the header,
+    //  a resumed job keeps the seeds it had before it stopped
+    masterSeed_ = saved->second;
+    seeds_.clear();
+    initialized_ = true;
+  } else if (seedMode_ == SEED_RUN) {
     masterSeed_ = rh.getRunNumber();
     initialized_ = true;
   }
-  std::string key = "RandomNumberMasterSeed[" + process().getPassName() + "]";
   rh.setIntParameter(key, int(masterSeed_));
 }
 
 uint64_t RandomNumberSeedService::getSeed(const std::string& name) const {
+  if (process().isResuming() and not process().hasInputFiles()) {
+    EXCEPTION_RAISE("ResumeSeed",
+                    "The seed '" + name +
+                        "' is the same for every event, a generator seeded "
+                        "with it would repeat the events from before the "
+                        "checkpoint. Seed generators with getEventSeed to "
+                        "resume jobs that produce events.");
+  }
   uint64_t seed(0);
   std::map<std::string, uint64_t>::const_iterator i = seeds_.find(name);
   if (i == seeds_.end()) {
@@ -68,6 +83,42 @@ uint64_t RandomNumberSeedService::getSeed(const std::string& name) const {
   return seed;
 }
 
+RandomNumberSeedService::SeedHandle RandomNumberSeedService::getSeedHandle(
+    const std::string& name) const {
+  // 64-bit FNV-1a, so similar names still give different counters
+  SeedHandle handle;
+  handle.hash_ = 0xcbf29ce484222325ULL;
+  for (unsigned char c : name) {
+    handle.hash_ ^= c;
+    handle.hash_ *= 0x100000001b3ULL;
+  }
+  return handle;
+}
+
+uint64_t RandomNumberSeedService::getEventSeed(
+    const SeedHandle& handle, const ldmx::EventHeader& header) const {
+  auto out = philox({uint32_t(header.getEventNumber()),
+                     uint32_t(header.getRun()), uint32_t(handle.hash_),
+                     uint32_t(handle.hash_ >> 32)},
+                    {uint32_t(masterSeed_), uint32_t(masterSeed_ >> 32)});
+  return (uint64_t(out[0]) << 32) | out[1];
+}
+
+std::array<uint32_t, 4> RandomNumberSeedService::philox(
+    std::array<uint32_t, 4> counter, std::array<uint32_t, 2> key) {
+  // constants from the reference implementation in Random123
+  static const uint32_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+  static const uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+  for (int round = 0; round < 10; round++) {
+    uint64_t p0 = uint64_t(M0) * counter[0], p1 = uint64_t(M1) * counter[2];
+    counter = {uint32_t(p1 >> 32) ^ counter[1] ^ key[0], uint32_t(p1),
+               uint32_t(p0 >> 32) ^ counter[3] ^ key[1], uint32_t(p0)};
+    key[0] += W0;
+    key[1] += W1;
+  }
+  return counter;
+}
+
 std::vector<std::string> RandomNumberSeedService::getSeedNames() const {
   std::vector<std::string> rv;
   for (auto i : seeds_) {
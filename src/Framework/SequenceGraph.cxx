@@ -0,0 +1,181 @@
+#include "Framework/SequenceGraph.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include "Framework/EventProcessor.h"
+
+namespace framework {
+
+namespace {
+
+/**
+ * Check if a product declared by a processor was produced by another
+ *
+ * @param produced tag declared by produces, only the name is set
+ * @param declared tag declared by consumes or produces
+ * @param passName name of the current pass
+ * @return true if the tags refer to the same product
+ */
+bool sameProduct(const ProductTag &produced, const ProductTag &declared,
+                 const std::string &passName) {
+  return produced.name() == declared.name() and
+         (declared.passname().empty() or declared.passname() == passName);
+}
+
+/**
+ * State of the processors for one event
+ *
+ * Shared with the tasks submitted to the pool, since a task may only
+ * start after the event is done (and then finds nothing to run).
+ */
+struct EventRun {
+  /// Graph being run
+  const std::vector<std::vector<std::size_t>> *successors;
+  /// Function running a processor
+  const std::function<void(std::size_t)> *runModule;
+  /// Pool to submit tasks to
+  ThreadPool *pool;
+  /// Guard for everything below
+  std::mutex mutex;
+  /// Signal that a processor finished or became ready
+  std::condition_variable changed;
+  /// Processors whose dependencies are all done
+  std::deque<std::size_t> ready;
+  /// Number of dependencies left for each processor
+  std::vector<int> remaining;
+  /// Number of processors that are done or skipped
+  std::size_t done{0};
+  /// True if a processor aborted the event
+  bool aborted{false};
+  /// First exception other than an abort
+  std::exception_ptr error;
+};
+
+/**
+ * Run one of the ready processors, if there are any
+ *
+ * Extra tasks are submitted to the pool for any processors that became
+ * ready beyond the first, which this thread picks up next.
+ *
+ * @param state EventRun to run a processor from
+ * @return false if there were no processors ready
+ */
+bool runReady(const std::shared_ptr<EventRun> &state) {
+  std::size_t node;
+  bool skip;
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (state->ready.empty()) return false;
+    node = state->ready.front();
+    state->ready.pop_front();
+    skip = state->aborted or state->error;
+  }
+
+  bool aborted{false};
+  std::exception_ptr error;
+  if (not skip) {
+    try {
+      (*state->runModule)(node);
+    } catch (AbortEventException &) {
+      aborted = true;
+    } catch (...) {
+      error = std::current_exception();
+    }
+  }
+
+  std::size_t newlyReady{0};
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (aborted) state->aborted = true;
+    if (error and not state->error) state->error = error;
+    for (std::size_t next : state->successors->at(node)) {
+      if (--state->remaining.at(next) == 0) {
+        state->ready.push_back(next);
+        newlyReady++;
+      }
+    }
+    state->done++;
+  }
+  state->changed.notify_all();
+
+  for (std::size_t i = 1; i < newlyReady; i++) {
+    state->pool->submit([state]() {
+      while (runReady(state))
+        ;
+    });
+  }
+  return true;
+}
+
+}  // namespace
+
+SequenceGraph::SequenceGraph(const std::vector<EventProcessor *> &sequence,
+                             const std::string &passName)
+    : successors_(sequence.size()), numDependencies_(sequence.size(), 0) {
+  auto undeclared = [](const EventProcessor *module) {
+    return module->getConsumedProducts().empty() and
+           module->getProducedProducts().empty();
+  };
+
+  for (std::size_t i = 0; i < sequence.size(); i++) {
+    const EventProcessor *later{sequence.at(i)};
+    for (std::size_t j = 0; j < i; j++) {
+      const EventProcessor *earlier{sequence.at(j)};
+      bool depends{undeclared(earlier) or undeclared(later)};
+      for (auto const &produced : earlier->getProducedProducts()) {
+        if (depends) break;
+        for (auto const &consumed : later->getConsumedProducts())
+          depends = depends or sameProduct(produced, consumed, passName);
+        for (auto const &alsoProduced : later->getProducedProducts())
+          depends = depends or sameProduct(produced, alsoProduced, passName);
+      }
+      if (depends) {
+        successors_.at(j).push_back(i);
+        numDependencies_.at(i)++;
+      }
+    }
+    // with no dependency on the one before it, this processor may run
+    // at the same time as it
+    if (i > 0 and (successors_.at(i - 1).empty() or
+                   successors_.at(i - 1).back() != i))
+      parallel_ = true;
+  }
+}
+
+bool SequenceGraph::run(
+    ThreadPool &pool, const std::function<void(std::size_t)> &runModule) const {
+  auto state{std::make_shared<EventRun>()};
+  state->successors = &successors_;
+  state->runModule = &runModule;
+  state->pool = &pool;
+  state->remaining = numDependencies_;
+  for (std::size_t i = 0; i < numDependencies_.size(); i++)
+    if (numDependencies_.at(i) == 0) state->ready.push_back(i);
+
+  std::size_t numReady{state->ready.size()};
+  for (std::size_t i = 1; i < numReady; i++) {
+    pool.submit([state]() {
+      while (runReady(state))
+        ;
+    });
+  }
+
+  while (true) {
+    if (runReady(state)) continue;
+    // everything that is ready is running on another thread,
+    //  so wait for one of them to finish
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->changed.wait(lock, [&]() {
+      return state->done == successors_.size() or not state->ready.empty();
+    });
+    if (state->done == successors_.size()) break;
+  }
+
+  if (state->error) std::rethrow_exception(state->error);
+  return state->aborted;
+}
+
+}  // namespace framework
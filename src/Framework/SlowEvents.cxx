@@ -0,0 +1,97 @@
+#include "Framework/SlowEvents.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include "Framework/EventProcessor.h"
+
+namespace framework {
+
+namespace {
+
+/// Order records so the fastest is on top of the heap
+bool slower(const SlowEvents::Record &lhs, const SlowEvents::Record &rhs) {
+  return lhs.seconds > rhs.seconds;
+}
+
+/**
+ * Write a record as one line of a table
+ *
+ * @param table stream to write to
+ * @param record slow event
+ */
+void writeRecord(std::ostream &table, const SlowEvents::Record &record) {
+  table << "\n  " << std::setw(10) << record.seconds * 1e3 << " ms  Run "
+        << record.source.run << " Event " << record.source.event;
+  if (record.source.entry >= 0)
+    table << "  (" << record.source.file << " entry " << record.source.entry
+          << ")";
+}
+
+}  // namespace
+
+SlowEvents::SlowEvents(std::size_t keep,
+                       const std::vector<EventProcessor *> &sequence)
+    : keep_{std::max<std::size_t>(keep, 1)},
+      lists_{std::make_unique<List[]>(sequence.size() + 1)} {
+  for (auto module : sequence) names_.push_back(module->getName());
+  for (std::size_t i = 0; i <= names_.size(); i++)
+    lists_[i].records.reserve(keep_);
+}
+
+void SlowEvents::add(std::size_t index, double seconds, const Source &source) {
+  if (not isSlow(index, seconds)) return;
+  List &list{lists_[index]};
+  std::lock_guard<std::mutex> lock(list.mutex);
+  if (list.records.size() < keep_) {
+    list.records.push_back({seconds, source});
+    std::push_heap(list.records.begin(), list.records.end(), slower);
+  } else if (seconds > list.records.front().seconds) {
+    std::pop_heap(list.records.begin(), list.records.end(), slower);
+    list.records.back() = {seconds, source};
+    std::push_heap(list.records.begin(), list.records.end(), slower);
+  }
+  if (list.records.size() == keep_)
+    list.threshold.store(list.records.front().seconds,
+                         std::memory_order_relaxed);
+}
+
+std::vector<SlowEvents::Record> SlowEvents::slowest(std::size_t index) const {
+  const List &list{lists_[index]};
+  std::vector<Record> records;
+  {
+    std::lock_guard<std::mutex> lock(list.mutex);
+    records = list.records;
+  }
+  std::sort(records.begin(), records.end(), slower);
+  return records;
+}
+
+std::map<std::string, std::set<long>> SlowEvents::inputEntries() const {
+  std::map<std::string, std::set<long>> entries;
+  for (std::size_t i = 0; i <= names_.size(); i++) {
+    for (auto const &record : slowest(i))
+      if (record.source.entry >= 0)
+        entries[record.source.file].insert(record.source.entry);
+  }
+  return entries;
+}
+
+std::string SlowEvents::summary() const {
+  // only the slowest few of each processor, they are all in the file
+  static const std::size_t perModule{3};
+  std::stringstream table;
+  table << std::fixed << std::setprecision(2);
+  table << "Slowest events";
+  for (auto const &record : slowest(eventIndex())) writeRecord(table, record);
+  for (std::size_t i = 0; i < names_.size(); i++) {
+    auto records{slowest(i)};
+    if (records.empty()) continue;
+    table << "\nSlowest calls of " << names_.at(i);
+    if (records.size() > perModule) records.resize(perModule);
+    for (auto const &record : records) writeRecord(table, record);
+  }
+  return table.str();
+}
+
+}  // namespace framework
@@ -1,15 +1,24 @@
 #include "Framework/StorageControl.h"
 #include <regex.h>
 #include <sys/types.h>
+#include <mutex>
 #include "Framework/Exception/Exception.h"
 
 namespace framework {
 
+/**
+ * Processors in the same event may vote at once when independent
+ * processors are run in parallel. Votes are rare, so one lock shared
+ * by all controllers is enough and keeps StorageControl copyable.
+ */
+static std::mutex hintsMutex;
+
 void StorageControl::resetEventState() { hints_.clear(); }
 
 void StorageControl::addHint(const std::string& processor_name,
                              framework::StorageControlHint hint,
                              const std::string& purposeString) {
+  std::lock_guard<std::mutex> lock(hintsMutex);
   hints_.push_back(Hint());
   hints_.back().evpName_ = processor_name;
   hints_.back().hint_ = hint;
@@ -48,6 +57,15 @@ void StorageControl::addRule(const std::string& processor_pat,
   rules_.back().purposePattern_ = purpose_pat;
 }
 
+bool StorageControl::canVote(const std::string& processor_name) const {
+  for (auto const& rule : rules_) {
+    if (!regexec((const regex_t*)(rule.evpNameRegex_), processor_name.c_str(),
+                 0, 0, 0))
+      return true;
+  }
+  return false;
+}
+
 bool StorageControl::Rule::matches(const StorageControl::Hint& h) {
   if (regexec((const regex_t*)(evpNameRegex_), h.evpName_.c_str(), 0, 0, 0))
     return false;
@@ -58,6 +76,7 @@ bool StorageControl::Rule::matches(const StorageControl::Hint& h) {
 }
 
 bool StorageControl::keepEvent() const {
+  std::lock_guard<std::mutex> lock(hintsMutex);
   int votesKeep(0), votesDrop(0);
   // loop over all rules and then over all hints
   for (auto rule : rules_) {
@@ -0,0 +1,37 @@
+#include "Framework/ThreadPool.h"
+
+namespace framework {
+
+ThreadPool::ThreadPool(int numThreads)
+    : numThreads_{numThreads < 1 ? 1 : numThreads} {
+  if (numThreads_ < 2) return;
+  for (int i = 0; i < numThreads_; i++) {
+    workers_.emplace_back([this]() { work(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  available_.notify_all();
+  for (auto &worker : workers_) worker.join();
+}
+
+void ThreadPool::work() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      available_.wait(lock, [this]() { return stopping_ or !tasks_.empty(); });
+      if (tasks_.empty()) return;  // stopping and nothing left to do
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    // exceptions are caught by the packaged task and end up in its future
+    task();
+  }
+}
+
+}  // namespace framework
@@ -0,0 +1,139 @@
+#include "Framework/TraceRecorder.h"
+
+#include <algorithm>
+#include <fstream>
+#include "Framework/Exception/Exception.h"
+
+namespace framework {
+
+namespace {
+
+/**
+ * Write a string as a JSON string, escaping what needs to be
+ *
+ * @param out stream to write to
+ * @param str string to write
+ */
+void writeString(std::ostream &out, const std::string &str) {
+  out << '"';
+  for (char c : str) {
+    if (c == '"' or c == '\\')
+      out << '\\' << c;
+    else if (static_cast<unsigned char>(c) < 0x20)
+      out << ' ';
+    else
+      out << c;
+  }
+  out << '"';
+}
+
+}  // namespace
+
+TraceRecorder &TraceRecorder::getInstance() {
+  static TraceRecorder instance;
+  return instance;
+}
+
+void TraceRecorder::enable(std::size_t capacity) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  capacity_ = std::max<std::size_t>(capacity, 1);
+  // the buffer grows as records come in, short jobs don't need all of it
+  records_.clear();
+  records_.reserve(std::min<std::size_t>(capacity_, 1024));
+  next_ = 0;
+  wrapped_ = false;
+  origin_ = std::chrono::steady_clock::now();
+  enabled_ = true;
+}
+
+void TraceRecorder::span(const char *category, const std::string &name,
+                         std::chrono::steady_clock::time_point start,
+                         long eventNumber) {
+  if (not isEnabled()) return;
+  auto end{std::chrono::steady_clock::now()};
+  push({category, name, 'X',
+        std::chrono::duration<double, std::micro>(start - origin_).count(),
+        std::chrono::duration<double, std::micro>(end - start).count(),
+        threadIndex(), eventNumber});
+}
+
+void TraceRecorder::instant(const char *category, const std::string &name) {
+  if (not isEnabled()) return;
+  push({category, name, 'i',
+        std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - origin_)
+            .count(),
+        0., threadIndex(), -1});
+}
+
+void TraceRecorder::write(const std::string &fileName) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::ofstream file(fileName);
+  if (not file) {
+    EXCEPTION_RAISE("TraceFile",
+                    "Unable to open '" + fileName + "' to write trace.");
+  }
+
+  file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+  // oldest record is at the next index once the buffer wraps
+  std::size_t first{wrapped_ ? next_ : 0};
+  for (std::size_t i = 0; i < records_.size(); i++) {
+    const Record &record{records_.at((first + i) % records_.size())};
+    file << (i > 0 ? ",\n" : "\n") << "{\"name\": ";
+    writeString(file, record.name);
+    file << ", \"cat\": \"" << record.category << "\", \"ph\": \""
+         << record.phase << "\", \"ts\": " << record.start
+         << ", \"pid\": 1, \"tid\": " << record.thread;
+    if (record.phase == 'X') file << ", \"dur\": " << record.duration;
+    if (record.phase == 'i') file << ", \"s\": \"g\"";
+    if (record.eventNumber >= 0)
+      file << ", \"args\": {\"event\": " << record.eventNumber << "}";
+    file << "}";
+  }
+  file << "\n]}\n";
+}
+
+void TraceRecorder::push(Record &&record) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (records_.size() < capacity_) {
+    // grow by doubling, but never past the maximum
+    if (records_.size() == records_.capacity())
+      records_.reserve(std::min(2 * records_.size(), capacity_));
+    records_.push_back(std::move(record));
+  } else {
+    records_[next_] = std::move(record);
+    wrapped_ = true;
+  }
+  next_ = (next_ + 1) % capacity_;
+}
+
+int TraceRecorder::threadIndex() {
+  static std::atomic<int> nextIndex{0};
+  static thread_local int index{nextIndex++};
+  return index;
+}
+
+TraceRecorder::Scope::Scope(const char *category, const char *name,
+                            long eventNumber)
+    : eventNumber_{eventNumber} {
+  if (not TraceRecorder::getInstance().isEnabled()) return;
+  category_ = category;
+  name_ = name;
+  start_ = std::chrono::steady_clock::now();
+}
+
+TraceRecorder::Scope::Scope(const char *category, const char *prefix,
+                            const std::string &suffix)
+    : eventNumber_{-1} {
+  if (not TraceRecorder::getInstance().isEnabled()) return;
+  category_ = category;
+  name_ = prefix + suffix;
+  start_ = std::chrono::steady_clock::now();
+}
+
+TraceRecorder::Scope::~Scope() {
+  if (category_)
+    TraceRecorder::getInstance().span(category_, name_, start_, eventNumber_);
+}
+
+}  // namespace framework
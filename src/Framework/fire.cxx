@@ -20,16 +20,15 @@
  */
 // using namespace framework;
 
-// This code allows ldmx-app to exit gracefully when Ctrl-c is used. It is
-// currently causing segfaults when certain processors are used.  The code
-// will remain commented out until these issues are investigated further.
-/*
-static Process* p { 0 };
-
-static void softFinish (int sig, siginfo_t *siginfo, void *context) {
-if (p) p->requestFinish();
+// This code allows fire to exit gracefully when Ctrl-c is used in a job
+// writing checkpoints. The handler only sets a flag, the Process finishes
+// the event it is on, writes a checkpoint and closes its files. A second
+// Ctrl-c exits immediately.
+static framework::Process* theProcess{nullptr};
+
+static void softFinish(int, siginfo_t*, void*) {
+  if (theProcess) theProcess->requestFinish();
 }
-*/
 
 /**
  * @func printUsage
@@ -59,8 +58,10 @@ int main(int argc, char* argv[]) {
   }
 
   int ptrpy = 1;
+  bool resume = false;
   for (ptrpy = 1; ptrpy < argc; ptrpy++) {
     if (strstr(argv[ptrpy], ".py")) break;
+    if (strcmp(argv[ptrpy], "--resume") == 0) resume = true;
   }
 
   if (ptrpy == argc) {
@@ -90,23 +91,29 @@ int main(int argc, char* argv[]) {
   std::cout << "---- LDMXSW: Configuration load complete  --------"
             << std::endl;
 
-  // If Ctrl-c is used, immediately exit the application.
+  if (resume) p->resume();
+
+  // If Ctrl-c is used, immediately exit the application, unless checkpoints
+  // are written. Then finish the current event and exit cleanly.
   struct sigaction act;
   memset(&act, '\0', sizeof(act));
+  if (p->isCheckpointing() or resume) {
+    theProcess = p.get();
+
+    /* Use the sa_sigaction field because the handles has two additional
+     * parameters */
+    act.sa_sigaction = &softFinish;
+
+    /* The SA_SIGINFO flag tells sigaction() to use the sa_sigaction field,
+     * not sa_handler. SA_RESETHAND puts back the default handler, so a second
+     * Ctrl-c exits immediately. */
+    act.sa_flags = SA_SIGINFO | SA_RESETHAND;
+  }
   if (sigaction(SIGINT, &act, NULL) < 0) {
     perror("sigaction");
     return 1;
   }
 
-  // See comment above for reason why this code is commented out.
-  /* Use the sa_sigaction field because the handles has two additional
-   * parameters */
-  // act.sa_sigaction = &softFinish;
-
-  /* The SA_SIGINFO flag tells sigaction() to use the sa_sigaction field, not
-   * sa_handler. */
-  // act.sa_flags = SA_SIGINFO;
-
   std::cout << "---- LDMXSW: Starting event processing --------" << std::endl;
 
   try {
@@ -133,9 +140,12 @@ int main(int argc, char* argv[]) {
 }
 
 void printUsage() {
-  std::cout << "Usage: fire {configuration_script.py} [arguments to "
+  std::cout << "Usage: fire [--resume] {configuration_script.py} [arguments to "
                "configuration script]"
             << std::endl;
+  std::cout << "     --resume                 (optional) continue from the "
+               "last checkpoint of the job"
+            << std::endl;
   std::cout << "     configuration_script.py  (required) python script to "
                "configure the processing"
             << std::endl;
@@ -0,0 +1,81 @@
+#include "catch.hpp"  // Catch2 Macros, TEST_CASE, REQUIRE
+
+#include <cstdio>  // for remove
+
+#include "Framework/Checkpoint.h"
+#include "Framework/Exception/Exception.h"
+
+/**
+ * Test for writing and reading checkpoints
+ *
+ * What does this even test?
+ *  - every field survives being written and read
+ *  - the master seed is only read back if one was written
+ *  - a file that isn't a complete checkpoint is refused
+ *  - the names of the files written by a resumed job
+ */
+TEST_CASE("Checkpoint", "[Framework][functionality]") {
+  using framework::Checkpoint;
+  const std::string fileName{"test_checkpoint.checkpoint"};
+
+  SECTION("round trip") {
+    Checkpoint written;
+    written.eventsProcessed = 1234;
+    written.inputFileIndex = 2;
+    written.inputFile = "some dir/input file.root";
+    written.nextEntry = 567;
+    written.outputEntries = 890;
+
+    SECTION("with master seed") {
+      written.hasMasterSeed = true;
+      written.run = 42;
+      written.masterSeed = 987654;
+      written.write(fileName);
+      Checkpoint read{Checkpoint::read(fileName)};
+      CHECK(read.hasMasterSeed);
+      CHECK(read.run == 42);
+      CHECK(read.masterSeed == 987654);
+    }
+
+    SECTION("without master seed") {
+      written.write(fileName);
+      Checkpoint read{Checkpoint::read(fileName)};
+      CHECK_FALSE(read.hasMasterSeed);
+    }
+
+    Checkpoint read{Checkpoint::read(fileName)};
+    CHECK(read.eventsProcessed == 1234);
+    CHECK(read.inputFileIndex == 2);
+    CHECK(read.inputFile == "some dir/input file.root");
+    CHECK(read.nextEntry == 567);
+    CHECK(read.outputEntries == 890);
+    CHECK(remove(fileName.c_str()) == 0);
+  }
+
+  SECTION("incomplete checkpoint") {
+    {
+      std::FILE* file = std::fopen(fileName.c_str(), "w");
+      REQUIRE(file);
+      std::fputs("eventsProcessed 10\ninputFileIndex -1\n", file);
+      std::fclose(file);
+    }
+    CHECK_THROWS_AS(Checkpoint::read(fileName),
+                    framework::exception::Exception);
+    CHECK(remove(fileName.c_str()) == 0);
+  }
+
+  SECTION("missing checkpoint") {
+    CHECK_THROWS_AS(Checkpoint::read("no_such_file.checkpoint"),
+                    framework::exception::Exception);
+  }
+
+  SECTION("resumed file names") {
+    CHECK(Checkpoint::resumedFileName("events.root", 100) ==
+          "events_resume100.root");
+    CHECK(Checkpoint::resumedFileName("dir.d/events.root", 7) ==
+          "dir.d/events_resume7.root");
+    CHECK(Checkpoint::resumedFileName("dir.d/events", 7) ==
+          "dir.d/events_resume7");
+    CHECK(Checkpoint::resumedFileName("events", 0) == "events_resume0");
+  }
+}
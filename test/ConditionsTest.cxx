@@ -0,0 +1,169 @@
+#include "catch.hpp"  // Catch2 Macros, TEST_CASE, REQUIRE
+
+#include <sstream>
+
+#include "Framework/Conditions.h"
+#include "Framework/ConditionsObjectProvider.h"
+#include "Framework/EventHeader.h"
+#include "Framework/Process.h"
+
+namespace framework {
+namespace test {
+
+/**
+ * @class RunConditionsProvider
+ * Provider of an object for each run, except the unlucky run 13
+ *
+ * Counts the objects it loads and keeps the runs of the ones released.
+ */
+class RunConditionsProvider : public ConditionsObjectProvider {
+ public:
+  RunConditionsProvider(const std::string& name, const std::string& tagname,
+                        const framework::config::Parameters& parameters,
+                        Process& process)
+      : ConditionsObjectProvider(name, tagname, parameters, process) {
+    loads = 0;
+    released.clear();
+  }
+
+  std::pair<const ConditionsObject*, ConditionsIOV> getCondition(
+      const ldmx::EventHeader& context) final override {
+    int run{context.getRun()};
+    if (run == 13) return {nullptr, ConditionsIOV()};
+    loads++;
+    return {new ConditionsObject(std::to_string(run)), ConditionsIOV(run, run)};
+  }
+
+  void releaseConditionsObject(const ConditionsObject* co) final override {
+    released.push_back(std::stoi(co->getName()));
+    delete co;
+  }
+
+  /// Number of objects loaded
+  static int loads;
+
+  /// Runs of the objects released, in order
+  static std::vector<int> released;
+};
+
+int RunConditionsProvider::loads{0};
+std::vector<int> RunConditionsProvider::released;
+
+/**
+ * Get the hits and misses of a condition from the summary table
+ *
+ * @param conditions Conditions to get the summary of
+ * @return hits and misses of the first condition in the table
+ */
+std::pair<long, long> getHitsAndMisses(const Conditions& conditions) {
+  std::istringstream table{conditions.summary()};
+  std::string header, name;
+  std::getline(table, header);
+  long hits{-1}, misses{-1};
+  table >> name >> hits >> misses;
+  return {hits, misses};
+}
+
+}  // namespace test
+}  // namespace framework
+
+DECLARE_CONDITIONS_PROVIDER_NS(framework::test, RunConditionsProvider)
+
+/**
+ * Test for the cache of conditions objects
+ *
+ * What does this even test?
+ *  - versions kept in the cache are used again without loading them
+ *  - the least recently used version is evicted when the cache is full
+ *    and only released in the next epoch
+ *  - hits and misses are counted
+ *  - a missing object is reported differently on the first load
+ *    and on a reload, and doesn't cost the versions that are kept
+ */
+TEST_CASE("Conditions cache", "[Framework][functionality]") {
+  using framework::test::getHitsAndMisses;
+  using framework::test::RunConditionsProvider;
+
+  auto process{framework::Process::getDummy()};
+  ldmx::EventHeader header;
+  process.setEventHeader(&header);
+  framework::Conditions conditions(process);
+
+  auto lookup = [&](int run) {
+    // like the Process, start a new epoch when the run changes
+    if (run != header.getRun()) conditions.newEpoch();
+    header.setRun(run);
+    return conditions.getConditionPtr("RunConditions")->getName();
+  };
+
+  SECTION("several versions") {
+    framework::config::Parameters parameters;
+    parameters.addParameter<int>("cacheSize", 2);
+    conditions.createConditionsObjectProvider(
+        "framework::test::RunConditionsProvider", "RunConditions", "",
+        parameters);
+
+    CHECK(lookup(1) == "1");
+    CHECK(lookup(2) == "2");
+    CHECK(lookup(1) == "1");
+    CHECK(RunConditionsProvider::loads == 2);
+    CHECK(RunConditionsProvider::released.empty());
+
+    // run 2 was used least recently, it is released in the next epoch
+    CHECK(lookup(3) == "3");
+    CHECK(RunConditionsProvider::released.empty());
+    CHECK(lookup(1) == "1");
+    CHECK(RunConditionsProvider::released == std::vector<int>{2});
+    CHECK(lookup(2) == "2");
+    CHECK(lookup(1) == "1");
+    CHECK(RunConditionsProvider::released == std::vector<int>{2, 3});
+    CHECK(RunConditionsProvider::loads == 4);
+    CHECK(getHitsAndMisses(conditions) == std::pair<long, long>{3, 4});
+
+    // the kept versions line up under their header
+    std::istringstream table{conditions.summary()};
+    std::string header, row;
+    std::getline(table, header);
+    std::getline(table, row);
+    CHECK(row.size() == header.size());
+    CHECK(row.substr(row.size() - 3) == "2/2");
+  }
+
+  SECTION("one version") {
+    framework::config::Parameters parameters;
+    conditions.createConditionsObjectProvider(
+        "framework::test::RunConditionsProvider", "RunConditions", "",
+        parameters);
+
+    CHECK(lookup(1) == "1");
+    CHECK(lookup(1) == "1");
+    CHECK(lookup(2) == "2");
+    CHECK(lookup(1) == "1");
+    CHECK(RunConditionsProvider::released == std::vector<int>{1});
+    conditions.newEpoch();
+    CHECK(RunConditionsProvider::released == std::vector<int>{1, 2});
+    CHECK(RunConditionsProvider::loads == 3);
+    CHECK(getHitsAndMisses(conditions) == std::pair<long, long>{1, 3});
+  }
+
+  SECTION("missing objects") {
+    framework::config::Parameters parameters;
+    conditions.createConditionsObjectProvider(
+        "framework::test::RunConditionsProvider", "RunConditions", "",
+        parameters);
+
+    SECTION("first load") {
+      CHECK_THROWS_WITH(lookup(13), Catch::Contains("Null condition"));
+      CHECK_THROWS_WITH(lookup(13), Catch::Contains("Null condition"));
+    }
+
+    SECTION("reload") {
+      CHECK(lookup(1) == "1");
+      CHECK_THROWS_WITH(lookup(13), Catch::Contains("Unable to update"));
+      // the version that is still valid was kept
+      CHECK(lookup(1) == "1");
+      CHECK(RunConditionsProvider::loads == 1);
+      CHECK(RunConditionsProvider::released.empty());
+    }
+  }
+}
@@ -0,0 +1,191 @@
+#include "catch.hpp"  // Catch2 Macros, TEST_CASE, REQUIRE
+
+#include "Framework/Event.h"
+
+#include "Recon/Event/CalorimeterHit.h"
+
+namespace framework {
+namespace test {
+
+/**
+ * Make a collection of hits with the input IDs, in the input order
+ *
+ * The energies are set in the same order as the IDs so that sorting
+ * by either gives the same order.
+ */
+std::vector<ldmx::CalorimeterHit> makeHits(const std::vector<int> &ids) {
+  std::vector<ldmx::CalorimeterHit> hits;
+  for (int id : ids) {
+    hits.emplace_back();
+    hits.back().setID(id);
+    hits.back().setEnergy(id);
+  }
+  return hits;
+}
+
+/// @return the IDs of the hits, in order
+std::vector<int> getIDs(const std::vector<ldmx::CalorimeterHit> &hits) {
+  std::vector<int> ids;
+  for (auto const &hit : hits) ids.push_back(hit.getID());
+  return ids;
+}
+
+}  // namespace test
+}  // namespace framework
+
+/**
+ * Test for adding products to the event bus
+ *
+ * What does this even test?
+ *  - copying a product leaves the original as it was
+ *  - moving a product puts the same content on the bus
+ *  - each sort policy orders the collection as documented
+ */
+TEST_CASE("Event::add", "[Framework][Event]") {
+  using framework::test::getIDs;
+  using framework::test::makeHits;
+  framework::Event event("test");
+
+  SECTION("copy") {
+    auto hits{makeHits({3, 1, 2})};
+    event.add("Hits", hits);
+    CHECK(getIDs(hits) == std::vector<int>{3, 1, 2});
+    CHECK(getIDs(event.getCollection<ldmx::CalorimeterHit>("Hits")) ==
+          std::vector<int>{1, 2, 3});
+  }
+
+  SECTION("move") {
+    auto hits{makeHits({3, 1, 2})};
+    event.add("Hits", std::move(hits));
+    CHECK(getIDs(event.getCollection<ldmx::CalorimeterHit>("Hits")) ==
+          std::vector<int>{1, 2, 3});
+  }
+
+  SECTION("sort policies") {
+    using framework::SortPolicy;
+
+    SECTION("Sort") {
+      event.add("Hits", makeHits({3, 1, 2}), SortPolicy::Sort);
+      CHECK(getIDs(event.getCollection<ldmx::CalorimeterHit>("Hits")) ==
+            std::vector<int>{1, 2, 3});
+    }
+
+    SECTION("AssumeSorted on sorted input") {
+      event.add("Hits", makeHits({1, 2, 3}), SortPolicy::AssumeSorted);
+      CHECK(getIDs(event.getCollection<ldmx::CalorimeterHit>("Hits")) ==
+            std::vector<int>{1, 2, 3});
+    }
+
+    SECTION("AssumeSorted on unsorted input still sorts") {
+      event.add("Hits", makeHits({3, 1, 2}), SortPolicy::AssumeSorted);
+      CHECK(getIDs(event.getCollection<ldmx::CalorimeterHit>("Hits")) ==
+            std::vector<int>{1, 2, 3});
+    }
+
+    SECTION("Unordered") {
+      event.add("Hits", makeHits({3, 1, 2}), SortPolicy::Unordered);
+      CHECK(getIDs(event.getCollection<ldmx::CalorimeterHit>("Hits")) ==
+            std::vector<int>{3, 1, 2});
+    }
+  }
+}
+
+/**
+ * Test for looking up products on the event bus
+ *
+ * What does this even test?
+ *  - exists compares names and pass names exactly and case-sensitively
+ *  - searchProducts still matches case-insensitive regular expressions
+ *  - a remembered search sees products added later in the event
+ */
+TEST_CASE("Event product lookup", "[Framework][Event]") {
+  using framework::test::makeHits;
+  framework::Event event("test");
+  event.add("EcalHits", makeHits({1, 2}));
+
+  SECTION("exists") {
+    CHECK(event.exists("EcalHits"));
+    CHECK(event.exists("EcalHits", "test"));
+    CHECK_FALSE(event.exists("ecalhits"));
+    CHECK_FALSE(event.exists("EcalHits", "TEST"));
+    CHECK_FALSE(event.exists("EcalHits", "other"));
+    CHECK_FALSE(event.exists("Hits"));
+    CHECK_FALSE(event.exists("Ecal.*"));
+    CHECK_FALSE(event.exists("HcalHits"));
+  }
+
+  SECTION("searchProducts") {
+    CHECK(event.searchProducts("hits", "", "").size() == 1);
+    CHECK(event.searchProducts("^Hits$", "", "").empty());
+    CHECK(event.searchProducts("", "TEST", "").size() == 1);
+    CHECK(event.searchProducts("", "other", "").empty());
+  }
+
+  SECTION("products added after a search") {
+    REQUIRE(event.searchProducts("Hits", "", "").size() == 1);
+    REQUIRE_FALSE(event.exists("HcalHits"));
+    event.add("HcalHits", makeHits({3}));
+    CHECK(event.searchProducts("Hits", "", "").size() == 2);
+    CHECK(event.exists("HcalHits"));
+  }
+}
+
+/**
+ * Test for producers that only run when their products are requested
+ *
+ * What does this even test?
+ *  - a producer runs the first time one of its products is requested
+ *  - it runs at most once per event, and again in the next event
+ *  - a producer reading its own products doesn't run itself again
+ *  - a producer requesting the products of another runs it first
+ *  - requests for the products of other passes don't run it, and the
+ *    error names the pass requested
+ */
+TEST_CASE("Event on-demand producers", "[Framework][Event]") {
+  using framework::test::getIDs;
+  using framework::test::makeHits;
+  framework::Event event("test");
+
+  int numHitsRuns{0}, numSumRuns{0};
+  std::size_t hitsProducer = event.addOnDemand({"Hits"}, [&]() {
+    numHitsRuns++;
+    event.add("Hits", makeHits({2, 1}));
+    // reading its own product back doesn't run it again
+    CHECK(event.getCollection<ldmx::CalorimeterHit>("Hits").size() == 2);
+  });
+  event.addOnDemand({"Sum"}, [&]() {
+    numSumRuns++;
+    std::vector<int> ids{
+        getIDs(event.getCollection<ldmx::CalorimeterHit>("Hits"))};
+    event.add("Sum", makeHits({ids.at(0) + ids.at(1)}));
+  });
+
+  SECTION("runs once when requested") {
+    CHECK(numHitsRuns == 0);
+    CHECK(getIDs(event.getCollection<ldmx::CalorimeterHit>("Hits")) ==
+          std::vector<int>{1, 2});
+    CHECK(getIDs(event.getCollection<ldmx::CalorimeterHit>("Hits", "test")) ==
+          std::vector<int>{1, 2});
+    event.runOnDemand(hitsProducer);
+    CHECK(numHitsRuns == 1);
+    CHECK(numSumRuns == 0);
+
+    event.Clear();
+    event.getCollection<ldmx::CalorimeterHit>("Hits");
+    CHECK(numHitsRuns == 2);
+  }
+
+  SECTION("requests from another on-demand producer") {
+    CHECK(getIDs(event.getCollection<ldmx::CalorimeterHit>("Sum")) ==
+          std::vector<int>{3});
+    CHECK(numSumRuns == 1);
+    CHECK(numHitsRuns == 1);
+  }
+
+  SECTION("products of other passes") {
+    CHECK_THROWS_WITH(
+        event.getCollection<ldmx::CalorimeterHit>("Hits", "other"),
+        Catch::Contains("pass 'other'"));
+    CHECK(numHitsRuns == 0);
+  }
+}
@@ -41,12 +41,28 @@ class TestProducer : public Producer {
   /// should we create the run header?
   bool createRunHeader_;
 
+  /// should we add the products through handles?
+  bool useHandles_;
+
+  /// handle to the collection
+  ProductHandle<std::vector<ldmx::CalorimeterHit>> testCollection_;
+
+  /// handle to the object
+  ProductHandle<ldmx::HcalVetoResult> testObject_;
+
  public:
   TestProducer(const std::string& name, Process& p) : Producer(name, p) {}
   ~TestProducer() {}
 
   void configure(framework::config::Parameters& p) final override {
     createRunHeader_ = p.getParameter<bool>("createRunHeader");
+    useHandles_ = p.getParameter<bool>("useHandles", false);
+  }
+
+  void onProcessStart() final override {
+    testCollection_ =
+        produces<std::vector<ldmx::CalorimeterHit>>("TestCollection");
+    testObject_ = produces<ldmx::HcalVetoResult>("TestObject");
   }
 
   void beforeNewRun(ldmx::RunHeader& header) final override {
@@ -66,7 +82,10 @@ class TestProducer : public Producer {
       caloHits.back().setID(i_event * 10 + i);
     }
 
-    REQUIRE_NOTHROW(event.add("TestCollection", caloHits));
+    if (useHandles_)
+      REQUIRE_NOTHROW(event.add(testCollection_, caloHits));
+    else
+      REQUIRE_NOTHROW(event.add("TestCollection", caloHits));
 
     ldmx::HcalHit maxPEHit;
     maxPEHit.setID(i_event);
@@ -75,7 +94,10 @@ class TestProducer : public Producer {
     res.setMaxPEHit(maxPEHit);
     res.setVetoResult(i_event % 2 == 0);
 
-    REQUIRE_NOTHROW(event.add("TestObject", res));
+    if (useHandles_)
+      REQUIRE_NOTHROW(event.add(testObject_, res));
+    else
+      REQUIRE_NOTHROW(event.add("TestObject", res));
 
     events_ = i_event;
 
@@ -85,6 +107,20 @@ class TestProducer : public Producer {
   }
 };  // TestProducer
 
+/**
+ * @class TestFilter
+ * Bare producer that votes to drop every event
+ */
+class TestFilter : public Producer {
+ public:
+  TestFilter(const std::string& name, Process& p) : Producer(name, p) {}
+  ~TestFilter() {}
+
+  void produce(framework::Event&) final override {
+    setStorageHint(hint_shouldDrop);
+  }
+};  // TestFilter
+
 /**
  * @class TestAnalyzer
  * Bare analyzer that looks for objects matching what the TestProducer put in.
@@ -103,6 +139,7 @@ class TestAnalyzer : public Analyzer {
     REQUIRE_NOTHROW(getHistoDirectory());
     test_hist_ = new TH1F("test_hist_", "Test Histogram", 101, -50, 50);
     test_hist_->SetCanExtend(TH1::kAllAxes);
+    test_object_ = consumes<ldmx::HcalVetoResult>("TestObject");
   }
 
   void analyze(const framework::Event& event) final override {
@@ -120,6 +157,13 @@ class TestAnalyzer : public Analyzer {
       test_hist_->Fill(caloHits.at(i).getID());
     }
 
+    // repeated reads should hand back the same bus storage, not copies
+    const auto& firstRead{
+        event.getCollection<ldmx::CalorimeterHit>("TestCollection")};
+    const auto& secondRead{
+        event.getCollection<ldmx::CalorimeterHit>("TestCollection")};
+    CHECK(&firstRead == &secondRead);
+
     ldmx::HcalVetoResult vetoRes;
     REQUIRE_NOTHROW(vetoRes =
                         event.getObject<ldmx::HcalVetoResult>("TestObject"));
@@ -129,12 +173,20 @@ class TestAnalyzer : public Analyzer {
     CHECK(maxPEHit.getID() == i_event);
     CHECK(vetoRes.passesVeto() == (i_event % 2 == 0));
 
+    // the declared handle should find the same product
+    const ldmx::HcalVetoResult* fromHandle{nullptr};
+    REQUIRE_NOTHROW(fromHandle = &event.getObject(test_object_));
+    CHECK(fromHandle->getMaxPEHit().getID() == i_event);
+
     return;
   }
 
  private:
   /// test histogram filled with event indices
   TH1F* test_hist_;
+
+  /// handle to the object put in by TestProducer
+  ProductHandle<ldmx::HcalVetoResult> test_object_;
 };  // TestAnalyzer
 
 /**
@@ -395,6 +447,7 @@ static bool runProcess(const std::map<std::string, std::any>& parameters) {
 }  // namespace framework
 
 DECLARE_PRODUCER_NS(framework::test, TestProducer)
+DECLARE_PRODUCER_NS(framework::test, TestFilter)
 DECLARE_ANALYZER_NS(framework::test, TestAnalyzer)
 
 /**
@@ -417,6 +470,8 @@ DECLARE_ANALYZER_NS(framework::test, TestAnalyzer)
  * What does this even test?
  *  - Event::add an object and a vector of objects (changing size and content)
  *  - Event::get an object and a vector of objects (changing size and content)
+ *  - Event::getObject with a declared ProductHandle
+ *  - Event::add with a declared ProductHandle on several streams
  *  - Event can switch to different input tree (Multiple Input Files)
  *  - Creating and filling a histogram
  *  - Reading from input file(s)
@@ -429,6 +484,9 @@ DECLARE_ANALYZER_NS(framework::test, TestAnalyzer)
  *  - writing and reading run headers
  *  - drop/keep rules for event bus passengers
  *  - skimming events (only keeping events meeting a certain criteria)
+ *  - marking a processor as a filter keeps the same events
+ *  - a module timing tree needs a histogram file
+ *  - several streams are refused with input files
  */
 TEST_CASE("Core Framework Functionality", "[Framework][functionality]") {
   using namespace framework;
@@ -506,6 +564,46 @@ TEST_CASE("Core Framework Functionality", "[Framework][functionality]") {
         REQUIRE(test::runProcess(process));
         CHECK_THAT(outputFiles.at(0), test::isGoodEventFile("test", 1, 1));
       }
+
+      SECTION("filter before a producer that votes") {
+        // TestFilter votes to drop every event and TestProducer votes to
+        // keep even events, ties go to the default of keeping them
+        std::map<std::string, std::any> filterParameters;
+        filterParameters["className"] =
+            std::string("framework::test::TestFilter");
+        filterParameters["instanceName"] = std::string("TestFilter");
+        SECTION("not marked as a filter") {
+          filterParameters["isFilter"] = false;
+        }
+        SECTION("marked as a filter") { filterParameters["isFilter"] = true; }
+        framework::config::Parameters filterConfig;
+        filterConfig.setParameters(filterParameters);
+        std::vector<std::string> rules = {"TestProducer", "", "TestFilter",
+                                          ""};
+        process["skimRules"] = rules;
+        sequence = {filterConfig, producerConfig};
+        process["sequence"] = sequence;
+        REQUIRE(test::runProcess(process));
+        CHECK_THAT(outputFiles.at(0), test::isGoodEventFile("test", 1, 1));
+      }
+
+      SECTION("several streams adding through handles") {
+        // each stream adds through the handles in more than one event
+        process["numStreams"] = 2;
+        process["maxEvents"] = 6;
+        producerParameters["useHandles"] = true;
+        producerConfig.setParameters(producerParameters);
+        sequence = {producerConfig};
+        process["sequence"] = sequence;
+        REQUIRE(test::runProcess(process));
+        CHECK_THAT(outputFiles.at(0), test::isGoodEventFile("test", 6, 1));
+      }
+
+      SECTION("module timing tree without a histogram file") {
+        // refused when configuring, before any events are processed
+        process["moduleTimingTree"] = true;
+        CHECK_FALSE(test::runProcess(process));
+      }
     }
 
     SECTION("with Analyses") {
@@ -608,6 +706,13 @@ TEST_CASE("Core Framework Functionality", "[Framework][functionality]") {
         CHECK(test::removeFile(hist_file_path));
       }
 
+      SECTION("several streams") {
+        // input files are only read one event at a time
+        process["inputFiles"] = inputFiles;
+        process["numStreams"] = 2;
+        CHECK_FALSE(test::runProcess(process));
+      }
+
     }  // Analysis Mode
 
     SECTION("Merge Mode") {
@@ -0,0 +1,26 @@
+#include "catch.hpp"  // Catch2 Macros, TEST_CASE, REQUIRE
+
+#include "Framework/RandomNumberSeedService.h"
+
+/**
+ * Test for the counter-based generator behind the per-event seeds
+ *
+ * The outputs are the known answers published with the Random123
+ * reference implementation of Philox4x32-10, so seeds are the same
+ * on every platform and in every release.
+ */
+TEST_CASE("Philox Known Answers", "[Framework][functionality]") {
+  using framework::RandomNumberSeedService;
+  using Output = std::array<uint32_t, 4>;
+
+  CHECK(RandomNumberSeedService::philox({0, 0, 0, 0}, {0, 0}) ==
+        Output{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8});
+  CHECK(RandomNumberSeedService::philox(
+            {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+            {0xffffffff, 0xffffffff}) ==
+        Output{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd});
+  CHECK(RandomNumberSeedService::philox(
+            {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344},
+            {0xa4093822, 0x299f31d0}) ==
+        Output{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1});
+}
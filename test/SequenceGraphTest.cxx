@@ -0,0 +1,152 @@
+#include "catch.hpp"  // Catch2 Macros, TEST_CASE, REQUIRE
+
+#include <mutex>
+
+#include "Framework/EventProcessor.h"
+#include "Framework/Process.h"
+#include "Framework/SequenceGraph.h"
+
+namespace framework {
+namespace test {
+
+/**
+ * @class DeclaringProcessor
+ * Bare producer whose declared products are set by the test
+ */
+class DeclaringProcessor : public Producer {
+ public:
+  DeclaringProcessor(const std::string& name, Process& process)
+      : Producer(name, process) {}
+  void produce(Event&) final override {}
+
+  /// Declare that this processor reads the product
+  void reads(const std::string& name, const std::string& passName = "") {
+    consumes<int>(name, passName);
+  }
+
+  /// Declare that this processor writes the product
+  void writes(const std::string& name) { produces<int>(name); }
+};
+
+/**
+ * Order that the processors of a sequence finish in
+ */
+class FinishOrder {
+ public:
+  /// Record that a processor finished
+  void finished(std::size_t i) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    order_.push_back(i);
+  }
+
+  /// @return position of the processor in the order it finished, -1 if not
+  int position(std::size_t i) const {
+    for (std::size_t j = 0; j < order_.size(); j++)
+      if (order_.at(j) == i) return j;
+    return -1;
+  }
+
+  /// @return number of processors that finished
+  std::size_t size() const { return order_.size(); }
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::size_t> order_;
+};
+
+}  // namespace test
+}  // namespace framework
+
+/**
+ * Test for ordering the processors of a sequence by their products
+ *
+ * What does this even test?
+ *  - a processor runs after the producers of everything it consumes
+ *  - processors that consume products of other passes don't wait
+ *  - processors that declared nothing wait for, and are waited for by, all
+ *  - an abort skips the processors that haven't started
+ *  - other exceptions are rethrown after the event
+ */
+TEST_CASE("SequenceGraph", "[Framework][functionality]") {
+  using framework::SequenceGraph;
+  using framework::test::DeclaringProcessor;
+  using framework::test::FinishOrder;
+
+  auto process{framework::Process::getDummy()};
+  DeclaringProcessor a("a", process), b("b", process), c("c", process),
+      d("d", process), undeclared("undeclared", process);
+  framework::ThreadPool pool(4);
+
+  SECTION("dependency ordering") {
+    a.writes("A");
+    b.writes("B");
+    c.reads("A");
+    c.reads("B", "test");
+    c.writes("C");
+    d.reads("C");
+    SequenceGraph graph({&a, &b, &c, &d}, "test");
+    CHECK(graph.isParallel());
+    for (int event = 0; event < 20; event++) {
+      FinishOrder order;
+      CHECK_FALSE(graph.run(pool, [&](std::size_t i) { order.finished(i); }));
+      REQUIRE(order.size() == 4);
+      CHECK(order.position(2) > order.position(0));
+      CHECK(order.position(2) > order.position(1));
+      CHECK(order.position(3) > order.position(2));
+    }
+  }
+
+  SECTION("products of other passes") {
+    a.writes("A");
+    b.reads("A", "other");
+    CHECK(SequenceGraph({&a, &b}, "test").isParallel());
+    CHECK_FALSE(SequenceGraph({&a, &b}, "other").isParallel());
+  }
+
+  SECTION("a chain is not parallel") {
+    a.writes("A");
+    b.reads("A");
+    b.writes("B");
+    c.reads("B");
+    CHECK_FALSE(SequenceGraph({&a, &b, &c}, "test").isParallel());
+  }
+
+  SECTION("undeclared processors are barriers") {
+    a.writes("A");
+    b.writes("B");
+    SequenceGraph graph({&a, &undeclared, &b}, "test");
+    CHECK_FALSE(graph.isParallel());
+    for (int event = 0; event < 20; event++) {
+      FinishOrder order;
+      CHECK_FALSE(graph.run(pool, [&](std::size_t i) { order.finished(i); }));
+      REQUIRE(order.size() == 3);
+      CHECK(order.position(1) > order.position(0));
+      CHECK(order.position(2) > order.position(1));
+    }
+  }
+
+  SECTION("abort skips the rest") {
+    a.writes("A");
+    b.reads("A");
+    b.writes("B");
+    c.reads("B");
+    SequenceGraph graph({&a, &b, &c}, "test");
+    FinishOrder order;
+    CHECK(graph.run(pool, [&](std::size_t i) {
+      if (i == 1) throw framework::AbortEventException();
+      order.finished(i);
+    }));
+    CHECK(order.size() == 1);
+  }
+
+  SECTION("exceptions are rethrown") {
+    a.writes("A");
+    b.writes("B");
+    SequenceGraph graph({&a, &b}, "test");
+    CHECK_THROWS_AS(graph.run(pool,
+                              [](std::size_t i) {
+                                if (i == 1) throw std::runtime_error("failed");
+                              }),
+                    std::runtime_error);
+  }
+}
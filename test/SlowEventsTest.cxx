@@ -0,0 +1,96 @@
+#include "catch.hpp"  // Catch2 Macros, TEST_CASE, REQUIRE
+
+#include "Framework/EventProcessor.h"
+#include "Framework/Process.h"
+#include "Framework/SlowEvents.h"
+
+namespace framework {
+namespace test {
+
+/**
+ * @class IdleProcessor
+ * Bare analyzer, only its name is used
+ */
+class IdleProcessor : public Analyzer {
+ public:
+  IdleProcessor(const std::string& name, Process& process)
+      : Analyzer(name, process) {}
+  void analyze(const Event&) final override {}
+};
+
+/// @return the event numbers of the records, in order
+std::vector<int> getEvents(const std::vector<SlowEvents::Record>& records) {
+  std::vector<int> events;
+  for (auto const& record : records) events.push_back(record.source.event);
+  return events;
+}
+
+}  // namespace test
+}  // namespace framework
+
+/**
+ * Test for keeping the slowest events of a job
+ *
+ * What does this even test?
+ *  - only the slowest events are kept, slowest first
+ *  - every time is slow until the list is full, then only the ones
+ *    slower than the fastest kept
+ *  - processors and whole events are kept in separate lists
+ *  - the input entries of the kept events are listed by file
+ */
+TEST_CASE("SlowEvents", "[Framework][functionality]") {
+  using framework::SlowEvents;
+  using framework::test::getEvents;
+
+  auto process{framework::Process::getDummy()};
+  framework::test::IdleProcessor first("first", process),
+      second("second", process);
+  SlowEvents slow(3, {&first, &second});
+
+  auto source = [](int event, long entry = -1) {
+    SlowEvents::Source source;
+    source.run = 1;
+    source.event = event;
+    source.entry = entry;
+    if (entry >= 0) source.file = event % 2 == 0 ? "even.root" : "odd.root";
+    return source;
+  };
+
+  SECTION("keeps the slowest") {
+    std::vector<double> seconds{0.5, 0.1, 0.9, 0.3, 0.7, 0.2, 0.8};
+    for (std::size_t i = 0; i < seconds.size(); i++)
+      slow.addEventTime(seconds.at(i), source(i + 1));
+    CHECK(getEvents(slow.slowest(slow.eventIndex())) ==
+          std::vector<int>{3, 7, 5});
+    CHECK(slow.slowest(0).empty());
+    CHECK(slow.slowest(1).empty());
+  }
+
+  SECTION("threshold") {
+    CHECK(slow.isSlow(0, 0.01));
+    slow.addModuleTime(0, 0.2, source(1));
+    slow.addModuleTime(0, 0.4, source(2));
+    CHECK(slow.isSlow(0, 0.01));
+    slow.addModuleTime(0, 0.3, source(3));
+    CHECK_FALSE(slow.isSlow(0, 0.1));
+    CHECK_FALSE(slow.isSlow(0, 0.2));
+    CHECK(slow.isSlow(0, 0.25));
+    slow.addModuleTime(0, 0.25, source(4));
+    CHECK_FALSE(slow.isSlow(0, 0.25));
+    CHECK(getEvents(slow.slowest(0)) == std::vector<int>{2, 3, 4});
+    CHECK(slow.isSlow(1, 0.01));
+    CHECK(slow.isSlow(slow.eventIndex(), 0.01));
+  }
+
+  SECTION("input entries") {
+    slow.addModuleTime(0, 0.1, source(1, 10));
+    slow.addModuleTime(1, 0.1, source(2, 20));
+    slow.addEventTime(0.1, source(1, 10));
+    slow.addEventTime(0.1, source(3, 30));
+    slow.addEventTime(0.1, source(4));
+    auto entries{slow.inputEntries()};
+    CHECK(entries.size() == 2);
+    CHECK(entries["odd.root"] == std::set<long>{10, 30});
+    CHECK(entries["even.root"] == std::set<long>{20});
+  }
+}